@@ -0,0 +1,358 @@
+#ifndef MEDIENINFO_ARITHMETICENCODER_H
+#define MEDIENINFO_ARITHMETICENCODER_H
+
+#include <array>
+#include <cstdint>
+#include <immintrin.h>
+#include "SampledWriter.h"
+
+constexpr uint32_t qmStateEntry(const uint32_t qe, const uint32_t nextLps, const uint32_t nextMps, const uint32_t switchMps) {
+    return (qe << 16) | (nextMps << 8) | (switchMps << 7) | nextLps;
+}
+
+/**
+ * Probability estimation state machine of ISO/IEC 10918-1 Table D.2, packed as Qe << 16 | Next_Index_MPS << 8 |
+ * Switch_MPS << 7 | Next_Index_LPS. The last entry is a fixed estimate of 0.5 for the sign of the AC coefficients.
+ */
+class QmStateTable {
+public:
+    static constexpr uint8_t fixedHalf = 113;
+
+    static constexpr std::array<uint32_t, 114> states {
+            qmStateEntry(0x5a1d, 1, 1, 1), qmStateEntry(0x2586, 14, 2, 0), qmStateEntry(0x1114, 16, 3, 0), qmStateEntry(0x080b, 18, 4, 0),
+            qmStateEntry(0x03d8, 20, 5, 0), qmStateEntry(0x01da, 23, 6, 0), qmStateEntry(0x00e5, 25, 7, 0), qmStateEntry(0x006f, 28, 8, 0),
+            qmStateEntry(0x0036, 30, 9, 0), qmStateEntry(0x001a, 33, 10, 0), qmStateEntry(0x000d, 35, 11, 0), qmStateEntry(0x0006, 9, 12, 0),
+            qmStateEntry(0x0003, 10, 13, 0), qmStateEntry(0x0001, 12, 13, 0), qmStateEntry(0x5a7f, 15, 15, 1), qmStateEntry(0x3f25, 36, 16, 0),
+            qmStateEntry(0x2cf2, 38, 17, 0), qmStateEntry(0x207c, 39, 18, 0), qmStateEntry(0x17b9, 40, 19, 0), qmStateEntry(0x1182, 42, 20, 0),
+            qmStateEntry(0x0cef, 43, 21, 0), qmStateEntry(0x09a1, 45, 22, 0), qmStateEntry(0x072f, 46, 23, 0), qmStateEntry(0x055c, 48, 24, 0),
+            qmStateEntry(0x0406, 49, 25, 0), qmStateEntry(0x0303, 51, 26, 0), qmStateEntry(0x0240, 52, 27, 0), qmStateEntry(0x01b1, 54, 28, 0),
+            qmStateEntry(0x0144, 56, 29, 0), qmStateEntry(0x00f5, 57, 30, 0), qmStateEntry(0x00b7, 59, 31, 0), qmStateEntry(0x008a, 60, 32, 0),
+            qmStateEntry(0x0068, 62, 33, 0), qmStateEntry(0x004e, 63, 34, 0), qmStateEntry(0x003b, 32, 35, 0), qmStateEntry(0x002c, 33, 9, 0),
+            qmStateEntry(0x5ae1, 37, 37, 1), qmStateEntry(0x484c, 64, 38, 0), qmStateEntry(0x3a0d, 65, 39, 0), qmStateEntry(0x2ef1, 67, 40, 0),
+            qmStateEntry(0x261f, 68, 41, 0), qmStateEntry(0x1f33, 69, 42, 0), qmStateEntry(0x19a8, 70, 43, 0), qmStateEntry(0x1518, 72, 44, 0),
+            qmStateEntry(0x1177, 73, 45, 0), qmStateEntry(0x0e74, 74, 46, 0), qmStateEntry(0x0bfb, 75, 47, 0), qmStateEntry(0x09f8, 77, 48, 0),
+            qmStateEntry(0x0861, 78, 49, 0), qmStateEntry(0x0706, 79, 50, 0), qmStateEntry(0x05cd, 48, 51, 0), qmStateEntry(0x04de, 50, 52, 0),
+            qmStateEntry(0x040f, 50, 53, 0), qmStateEntry(0x0363, 51, 54, 0), qmStateEntry(0x02d4, 52, 55, 0), qmStateEntry(0x025c, 53, 56, 0),
+            qmStateEntry(0x01f8, 54, 57, 0), qmStateEntry(0x01a4, 55, 58, 0), qmStateEntry(0x0160, 56, 59, 0), qmStateEntry(0x0125, 57, 60, 0),
+            qmStateEntry(0x00f6, 58, 61, 0), qmStateEntry(0x00cb, 59, 62, 0), qmStateEntry(0x00ab, 61, 63, 0), qmStateEntry(0x008f, 61, 32, 0),
+            qmStateEntry(0x5b12, 65, 65, 1), qmStateEntry(0x4d04, 80, 66, 0), qmStateEntry(0x412c, 81, 67, 0), qmStateEntry(0x37d8, 82, 68, 0),
+            qmStateEntry(0x2fe8, 83, 69, 0), qmStateEntry(0x293c, 84, 70, 0), qmStateEntry(0x2379, 86, 71, 0), qmStateEntry(0x1edf, 87, 72, 0),
+            qmStateEntry(0x1aa9, 87, 73, 0), qmStateEntry(0x174e, 72, 74, 0), qmStateEntry(0x1424, 72, 75, 0), qmStateEntry(0x119c, 74, 76, 0),
+            qmStateEntry(0x0f6b, 74, 77, 0), qmStateEntry(0x0d51, 75, 78, 0), qmStateEntry(0x0bb6, 77, 79, 0), qmStateEntry(0x0a40, 77, 48, 0),
+            qmStateEntry(0x5832, 80, 81, 1), qmStateEntry(0x4d1c, 88, 82, 0), qmStateEntry(0x438e, 89, 83, 0), qmStateEntry(0x3bdd, 90, 84, 0),
+            qmStateEntry(0x34ee, 91, 85, 0), qmStateEntry(0x2eae, 92, 86, 0), qmStateEntry(0x299a, 93, 87, 0), qmStateEntry(0x2516, 86, 71, 0),
+            qmStateEntry(0x5570, 88, 89, 1), qmStateEntry(0x4ca9, 95, 90, 0), qmStateEntry(0x44d9, 96, 91, 0), qmStateEntry(0x3e22, 97, 92, 0),
+            qmStateEntry(0x3824, 99, 93, 0), qmStateEntry(0x32b4, 99, 94, 0), qmStateEntry(0x2e17, 93, 86, 0), qmStateEntry(0x56a8, 95, 96, 1),
+            qmStateEntry(0x4f46, 101, 97, 0), qmStateEntry(0x47e5, 102, 98, 0), qmStateEntry(0x41cf, 103, 99, 0), qmStateEntry(0x3c3d, 104, 100, 0),
+            qmStateEntry(0x375e, 99, 93, 0), qmStateEntry(0x5231, 105, 102, 0), qmStateEntry(0x4c0f, 106, 103, 0), qmStateEntry(0x4639, 107, 104, 0),
+            qmStateEntry(0x415e, 103, 99, 0), qmStateEntry(0x5627, 105, 106, 1), qmStateEntry(0x50e7, 108, 107, 0), qmStateEntry(0x4b85, 109, 103, 0),
+            qmStateEntry(0x5597, 110, 109, 0), qmStateEntry(0x504f, 111, 107, 0), qmStateEntry(0x5a10, 110, 111, 1), qmStateEntry(0x5522, 112, 109, 0),
+            qmStateEntry(0x59eb, 112, 111, 1), qmStateEntry(0x5a1d, 113, 113, 0)
+    };
+};
+
+/**
+ * The adaptive binary arithmetic coder (QM-coder) of ISO/IEC 10918-1 Annex D. Every decision is coded with a
+ * statistics byte (bit 7 the more probable symbol, bits 0..6 the index into QmStateTable) that adapts as it is used.
+ * The coder writes whole bytes and stuffs a 0x00 behind every 0xFF itself, so the stream has to be byte aligned.
+ */
+template<typename Stream>
+class QmEncoder {
+private:
+    Stream& stream;
+    // C register laid out like in D.1.3 with 3 spacer bits, A register
+    uint32_t c = 0;
+    int32_t a = 0x10000;
+    // stacked 0xFF bytes that a carry might still turn into 0x00, pending 0x00 bytes that might be dropped at the end
+    int32_t stacked = 0, zeros = 0;
+    // shifts until the next byte is complete
+    int bitsToByte = 11;
+    // the latest byte besides 0xFF, -1 when there is none yet
+    int buffer = -1;
+
+    inline void emit(const uint8_t byte) {
+        stream.writeByteAligned(byte);
+        if (byte == 0xFF) {
+            stream.writeByteAligned(0x00);
+        }
+    }
+
+    inline void emitZeros() {
+        for (; zeros > 0; --zeros) {
+            stream.writeByteAligned(0x00);
+        }
+    }
+
+    // a carry into the buffered byte, the stacked 0xFF bytes become 0x00
+    inline void carry() {
+        if (buffer >= 0) {
+            emitZeros();
+            emit(static_cast<uint8_t>(buffer + 1));
+        }
+        zeros += stacked;
+        stacked = 0;
+    }
+
+    // the buffered byte and the stacked 0xFF bytes are final
+    inline void release() {
+        if (buffer == 0) {
+            ++zeros;
+        } else if (buffer > 0) {
+            emitZeros();
+            emit(static_cast<uint8_t>(buffer));
+        }
+        if (stacked != 0) {
+            emitZeros();
+            for (; stacked > 0; --stacked) {
+                emit(0xFF);
+            }
+        }
+    }
+
+public:
+    explicit QmEncoder(Stream& stream) : stream(stream) {}
+
+    /**
+     * Codes the decision bit with the statistics byte state and adapts it (D.1.4 to D.1.6).
+     */
+    inline void encode(uint8_t& state, const int bit) {
+        const uint32_t entry = QmStateTable::states[state & 0x7F];
+        const int32_t qe = static_cast<int32_t>(entry >> 16);
+
+        a -= qe;
+        if (bit != (state >> 7)) {
+            // the less probable symbol, the subintervals are exchanged when the LPS one is the larger
+            if (a >= qe) {
+                c += static_cast<uint32_t>(a);
+                a = qe;
+            }
+            state = static_cast<uint8_t>((state & 0x80) ^ (entry & 0xFF));
+        } else {
+            if (a >= 0x8000) {
+                return;
+            }
+            if (a < qe) {
+                c += static_cast<uint32_t>(a);
+                a = qe;
+            }
+            state = static_cast<uint8_t>((state & 0x80) ^ ((entry >> 8) & 0xFF));
+        }
+
+        // renormalisation, a byte is complete every 8 shifts
+        do {
+            a <<= 1;
+            c <<= 1;
+            if (--bitsToByte == 0) {
+                const int byte = static_cast<int>(c >> 19);
+                if (byte > 0xFF) {
+                    carry();
+                    // the spacer bits make sure this can not be 0xFF
+                    buffer = byte & 0xFF;
+                } else if (byte == 0xFF) {
+                    ++stacked;
+                } else {
+                    release();
+                    buffer = byte;
+                }
+                c &= 0x7FFFF;
+                bitsToByte += 8;
+            }
+        } while (a < 0x8000);
+    }
+
+    /**
+     * Terminates the coded segment (D.1.8) with as few bytes as possible, e.g. before a restart marker.
+     */
+    void finish() {
+        // the value in the interval with the most trailing zero bits
+        const uint32_t rounded = (static_cast<uint32_t>(a) - 1 + c) & 0xFFFF0000;
+        c = rounded < c ? rounded + 0x8000 : rounded;
+
+        c <<= bitsToByte;
+        if (c & 0xF8000000u) {
+            carry();
+        } else {
+            release();
+        }
+
+        // trailing 0x00 bytes are implied by the decoder
+        if (c & 0x7FFF800) {
+            emitZeros();
+            emit(static_cast<uint8_t>(c >> 19));
+            if (c & 0x7F800) {
+                emit(static_cast<uint8_t>(c >> 11));
+            }
+        }
+        reset();
+    }
+
+    void reset() {
+        c = 0;
+        a = 0x10000;
+        stacked = 0;
+        zeros = 0;
+        bitsToByte = 11;
+        buffer = -1;
+    }
+};
+
+/**
+ * Adaptive statistics of one DC and one AC conditioning table (F.1.4.4), reset at every restart marker.
+ */
+struct ArithmeticStatistics {
+    std::array<uint8_t, 64> dc;
+    std::array<uint8_t, 256> ac;
+
+    ArithmeticStatistics() {
+        reset();
+    }
+
+    void reset() {
+        dc.fill(0);
+        ac.fill(0);
+    }
+};
+
+/**
+ * Arithmetic codes blocks from the quantised coefficients of a channel with the model of ISO/IEC 10918-1 F.1.4, the
+ * counterpart of CoefficientStreamWriter. The conditioning parameters are the defaults DAC.h writes.
+ */
+template<typename T, typename Stream = BitStream>
+class ArithmeticBlockWriter {
+public:
+    // DC conditioning bounds L and U, AC conditioning threshold Kx
+    static constexpr int dcLower = 0, dcUpper = 1, acThreshold = 5;
+
+private:
+    const OffsetSampledWriter<T, int16_t>* channel;
+    QmEncoder<Stream>& coder;
+    ArithmeticStatistics& statistics;
+    int16_t previousDc = 0;
+    // offset of the statistics of the next DC difference, depends on the category of the previous one
+    int dcContext = 0;
+    // the sign of the AC coefficients is coded with a fixed probability of 0.5
+    uint8_t fixedHalf = QmStateTable::fixedHalf;
+
+    // the bits of value below the leading one m, with the statistics 14 behind the last category decision
+    inline void encodeMagnitudeBits(uint8_t* st, const int value, int m) {
+        st += 14;
+        while (m >>= 1) {
+            coder.encode(*st, (m & value) ? 1 : 0);
+        }
+    }
+
+public:
+    ArithmeticBlockWriter(const OffsetSampledWriter<T, int16_t>& channel, QmEncoder<Stream>& coder, ArithmeticStatistics& statistics)
+        : channel(&channel), coder(coder), statistics(statistics) {}
+
+    // continues with the blocks of another channel buffer, the DC prediction carries over
+    void setChannel(const OffsetSampledWriter<T, int16_t>& next) {
+        channel = &next;
+    }
+
+    // the DC prediction and its conditioning start over after a restart marker
+    void resetPrediction() {
+        previousDc = 0;
+        dcContext = 0;
+    }
+
+    void writeBlock(const uint32_t block) {
+        const int16_t* values = channel->blockCoefficients(block);
+
+        // F.1.4.1: the DC difference, conditioned on the category of the previous difference
+        uint8_t* st = &statistics.dc[dcContext];
+        int v = values[0] - previousDc;
+        previousDc = values[0];
+        if (v == 0) {
+            coder.encode(*st, 0);
+            dcContext = 0;
+        } else {
+            coder.encode(*st, 1);
+            if (v > 0) {
+                coder.encode(st[1], 0);
+                st += 2;
+                dcContext = 4;
+            } else {
+                v = -v;
+                coder.encode(st[1], 1);
+                st += 3;
+                dcContext = 8;
+            }
+
+            // the magnitude category, every category above the first has its own statistics from X1 = 20 on
+            int m = 0;
+            if ((v -= 1) != 0) {
+                coder.encode(*st, 1);
+                m = 1;
+                int remaining = v;
+                st = &statistics.dc[20];
+                while (remaining >>= 1) {
+                    coder.encode(*st, 1);
+                    m <<= 1;
+                    ++st;
+                }
+            }
+            coder.encode(*st, 0);
+
+            if (m < ((1 << dcLower) >> 1)) {
+                dcContext = 0;
+            } else if (m > ((1 << dcUpper) >> 1)) {
+                dcContext += 8;
+            }
+            encodeMagnitudeBits(st, v, m);
+        }
+
+        // F.1.4.2: the AC coefficients up to the last non zero one, every position has its own statistics for the
+        // EOB, the zero and the first magnitude decisions
+        const uint64_t mask = channel->nonZeroMasks[block] & ~1ull;
+        const unsigned int last = mask == 0 ? 0 : 63 - static_cast<unsigned int>(_lzcnt_u64(mask));
+
+        unsigned int k = 1;
+        for (; k <= last; ++k) {
+            st = &statistics.ac[3 * (k - 1)];
+            coder.encode(st[0], 0);
+            while ((v = values[k]) == 0) {
+                coder.encode(st[1], 0);
+                st += 3;
+                ++k;
+            }
+            coder.encode(st[1], 1);
+
+            if (v > 0) {
+                coder.encode(fixedHalf, 0);
+            } else {
+                v = -v;
+                coder.encode(fixedHalf, 1);
+            }
+
+            // the first two category decisions share the statistics of the position, the larger categories are
+            // shared by the low (189) or the high (217) positions
+            st += 2;
+            int m = 0;
+            if ((v -= 1) != 0) {
+                coder.encode(*st, 1);
+                m = 1;
+                int remaining = v;
+                if (remaining >>= 1) {
+                    coder.encode(*st, 1);
+                    m <<= 1;
+                    st = &statistics.ac[k <= acThreshold ? 189 : 217];
+                    while (remaining >>= 1) {
+                        coder.encode(*st, 1);
+                        m <<= 1;
+                        ++st;
+                    }
+                }
+            }
+            coder.encode(*st, 0);
+            encodeMagnitudeBits(st, v, m);
+        }
+
+        // EOB unless the last coefficient was coded
+        if (k <= 63) {
+            coder.encode(statistics.ac[3 * (k - 1)], 1);
+        }
+    }
+};
+
+#endif //MEDIENINFO_ARITHMETICENCODER_H
@@ -10,6 +10,7 @@
 #include <cstring>
 #include <iostream>
 #include <fstream>
+#include <array>
 
 #define _write_segment_ref(bitstream, segment) bitstream.writeBytes(&segment, sizeof(segment))
 
@@ -154,12 +155,30 @@ public:
         if (position_bit != 0) {
             const uint8_t pad = 8 - position_bit;
             const uint8_t append = ones(pad);
-            *(streamStart + position) |= append;
+            const auto pos = streamStart + position;
+            *pos |= append;
             ++position;
             position_bit = 0;
+
+            if(*pos == 0xFF) // the padding can complete a 0xFF byte as well
+            {
+                ++position;
+                *(pos + 1) = 0x00;
+            }
         }
     }
 
+    /**
+     * The written bytes, the stream has to be byte aligned (see fillByte) to use them.
+     */
+    inline const uint8_t* data() const {
+        return streamStart;
+    }
+
+    inline uint64_t length() const {
+        return position;
+    }
+
     /**
      * Save the stream to disk
      */
@@ -239,7 +258,7 @@ public:
         assert(amount <= 16);
         //assert((data & ~ones(amount)) == 0); // check all unimportant bytes are zero
         assert(size > ((position << 3) + position_bit + amount) / 8);
-        data &= ~ones(amount);
+        data &= ones(amount);
 
         buffer <<= amount;
         buffer |= data;
@@ -250,6 +269,10 @@ public:
             uint8_t tbuffer = static_cast<uint8_t>(tmp);
             assert((tmp & ones(8)) == tbuffer); // check all unimportant bytes are zero
             writeByteAlignedUnsafe(tbuffer);
+            // byte stuffing, 0xFF in the entropy coded data has to be followed by 0x00
+            if(tbuffer == 0xFF) {
+                writeByteAlignedUnsafe(0x00);
+            }
             position_bit -= 8;
         }
 
@@ -274,6 +297,17 @@ public:
         assert(position_bit == 0);
     }
 
+    /**
+     * The written bytes, the stream has to be byte aligned (see fillByte) to use them.
+     */
+    inline const uint8_t* data() const {
+        return streamStart;
+    }
+
+    inline uint64_t length() const {
+        return position;
+    }
+
     /**
      * Save the stream to disk
      */
@@ -315,6 +349,171 @@ public:
 
 };
 
+/**
+ * Collects the bits right aligned in a 64 bit register and writes them 32 bits at a time. A SWAR test on the whole
+ * word tells whether it contains a 0xFF byte, only then the word is written byte by byte with the stuffed zeros.
+ */
+class BitStreamAccumulator {
+private:
+    uint8_t* streamStart;
+    const std::string fileName;
+    uint64_t position = 0; // byte position
+    uint64_t size;
+    uint64_t buffer = 0; // the lowest $pending bits are not written yet
+    uint8_t pending = 0;
+    const int width;
+    const int height;
+
+    /**
+     * True if any byte of the word is 0xFF, i.e. if the inverted word has a zero byte.
+     */
+    static constexpr bool containsFF(const uint32_t word) {
+        const uint32_t inverted = ~word;
+        return ((inverted - 0x01010101u) & ~inverted & 0x80808080u) != 0;
+    }
+
+    inline void writeStuffed(const uint8_t b) {
+        *(streamStart + position) = b;
+        ++position;
+
+        // byte stuffing, 0xFF in the entropy coded data has to be followed by 0x00
+        if(b == 0xFF) {
+            *(streamStart + position) = 0x00;
+            ++position;
+        }
+    }
+
+    inline void flushWord() {
+        assert(pending >= 32);
+        assert((position + 8) < size);
+
+        pending -= 32;
+        const auto word = static_cast<uint32_t>(buffer >> pending);
+
+        if(!containsFF(word)) {
+            const uint32_t bigEndian = __builtin_bswap32(word);
+            std::memcpy(streamStart + position, &bigEndian, sizeof(bigEndian));
+            position += sizeof(bigEndian);
+        }
+        else {
+            writeStuffed(static_cast<uint8_t>(word >> 24));
+            writeStuffed(static_cast<uint8_t>(word >> 16));
+            writeStuffed(static_cast<uint8_t>(word >> 8));
+            writeStuffed(static_cast<uint8_t>(word));
+        }
+    }
+
+public:
+    BitStreamAccumulator(std::string fileName, const unsigned int width, const unsigned int height) :
+        fileName(std::move(fileName)), width(width), height(height)
+    {
+        size = 1024 + width * height * 24; // byte approximation for memory usage
+        streamStart = static_cast<uint8_t *>(malloc(size));
+
+        if(streamStart == nullptr)
+            throw std::bad_alloc();
+    }
+
+    ~BitStreamAccumulator() {
+        free(streamStart);
+    }
+
+    void writeBytes(const void* bytes, const size_t len) {
+        assert((position + static_cast<uint64_t>(len)) < size);
+        assert(pending == 0);
+
+        std::memcpy(streamStart + position, bytes, len);
+        position += static_cast<uint64_t>(len);
+    }
+
+    inline void writeByteAligned(const uint8_t b) {
+        assert((position + 1)  < size);
+        assert(pending == 0);
+
+        *(streamStart + position) = b;
+        ++position;
+    }
+
+    /**
+     * Write up to 16 bits to the stream. At most 31 bits are pending before, so the register never overflows.
+     */
+    inline void appendU16(const uint16_t data, const uint8_t amount) {
+        assert(amount <= 16);
+
+        buffer = (buffer << amount) | (data & ones(amount));
+        pending += amount;
+
+        if(pending >= 32) {
+            flushWord();
+        }
+    }
+
+    /**
+     * Write up to 8 bits to the stream
+     */
+    inline void appendBit(const uint8_t data, const uint8_t amount) {
+        assert(amount <= 8);
+        appendU16(data, amount);
+    }
+
+    /**
+     * Fill a partially filled byte with ones and write all pending bytes, the stream is byte aligned afterwards.
+     */
+    void fillByte() {
+        if((pending & 7) != 0) {
+            const uint8_t pad = 8 - (pending & 7);
+            appendU16(static_cast<uint16_t>(ones(pad)), pad);
+        }
+
+        while(pending != 0) {
+            pending -= 8;
+            writeStuffed(static_cast<uint8_t>(buffer >> pending));
+        }
+    }
+
+    /**
+     * The written bytes, the stream has to be byte aligned (see fillByte) to use them.
+     */
+    inline const uint8_t* data() const {
+        return streamStart;
+    }
+
+    inline uint64_t length() const {
+        return position;
+    }
+
+    /**
+     * Save the stream to disk
+     */
+    void writeOut() {
+        fillByte();
+        auto file = std::fstream(fileName, std::ios::out | std::ios::binary);
+        file.write((char*)streamStart, position);
+        file.close();
+    }
+
+    /**
+     * Return an uint64_t with the rightmost $amount bytes set to one
+     */
+    static constexpr uint64_t ones(const int amount) {
+        assert(amount < 63 && amount >= 0);
+        return (static_cast<uint64_t>(1) << amount) - 1;
+    }
+
+    static constexpr std::array<uint8_t, 9> ones_u8 {
+            0,
+            1,
+            0b00000011,
+            0b00000111,
+            0b00001111,
+            0b00011111,
+            0b00111111,
+            0b01111111,
+            0b11111111,
+    };
+
+};
+
 typedef BitStreamSeb BitStream;
 
 #endif //MEDIENINFO_BITSTREAM_H
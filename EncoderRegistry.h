@@ -0,0 +1,198 @@
+#ifndef MEDIENINFO_ENCODERREGISTRY_H
+#define MEDIENINFO_ENCODERREGISTRY_H
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <stdexcept>
+#include "EncodingProcessor.h"
+#include "BitStream.h"
+#include "HuffmenTreeSorts/HuffmanTreeIsoSort.h"
+#include "HuffmenTreeSorts/HuffmanTreeSort.h"
+#include "HuffmenTreeSorts/HuffmanTreeMoffat.h"
+#include "HuffmenTreeSorts/HuffmanTreePackageMerge.h"
+#include "dct/DirectCosinusTransform.h"
+#include "dct/SeparatedCosinusTransform.h"
+#include "dct/AraiSimdSimple.h"
+#include "dct/LoefflerSimd.h"
+
+/**
+ * One encoder pipeline with a fixed transform, Huffman tree builder and bit stream.
+ */
+class EncoderEngine {
+public:
+    virtual ~EncoderEngine() = default;
+
+    // encodes the image into a bit stream for the given file, nothing is written until writeOut is called
+    virtual void encode(BlockwiseRawImage& image, const std::string& outputPath) = 0;
+
+    virtual void writeOut() = 0;
+
+    // decodes a baseline JPEG to its coefficients and writes them again with optimised tables, or progressive with a
+    // scan script. Only the restart interval and the scan script of the settings are used.
+    virtual void reoptimise(const std::string& inputPath, const std::string& outputPath) = 0;
+
+    // uses the Annex K tables scaled to the IJG quality (1..100) instead of the default tables for the next images
+    virtual void setQuality(int quality) = 0;
+
+    // enables the rate-distortion optimised quantisation for the next images
+    virtual void setTrellis(bool enabled) = 0;
+
+    // writes a restart marker every interval MCUs (0 disables them) and entropy codes the intervals in parallel
+    virtual void setRestartInterval(unsigned int interval) = 0;
+
+    // encodes in a single pass with the Annex K Huffman tables instead of building optimised ones
+    virtual void setStandardTables(bool enabled) = 0;
+
+    // counts only the symbol statistics in the first pass and entropy codes the scan from the quantised coefficients
+    virtual void setCoefficientScan(bool enabled) = 0;
+
+    // builds the tables from every rows-th row of MCUs and streams the scan (0 uses all MCUs)
+    virtual void setSampleRows(unsigned int rows) = 0;
+
+    // encodes in a single pass with the tables of a trained profile, nullptr builds the tables per image again
+    virtual void setProfile(std::shared_ptr<const HuffmanTableProfile> profile) = 0;
+
+    // codes the scan with the adaptive arithmetic coder instead of Huffman tables, in a single pass
+    virtual void setArithmeticCoding(bool enabled) = 0;
+
+    // writes progressive images with the scans of the script, nullptr writes a single sequential scan
+    virtual void setScanScript(std::shared_ptr<const ScanScript> script) = 0;
+
+    // the size encode would write with the current settings, computed from the symbol histograms
+    virtual EncodedSizePrediction predictSize(BlockwiseRawImage& image) = 0;
+};
+
+template<typename T, typename Transform, typename HT, typename Stream>
+class SpecialisedEncoderEngine : public EncoderEngine {
+private:
+    ImageProcessor<T, Transform, HT, Stream> processor;
+    std::unique_ptr<Stream> stream;
+
+public:
+    void encode(BlockwiseRawImage& image, const std::string& outputPath) override {
+        stream = std::make_unique<Stream>(outputPath, image.width, image.height);
+        processor.processImage(image, *stream);
+    }
+
+    void writeOut() override {
+        stream->writeOut();
+    }
+
+    void reoptimise(const std::string& inputPath, const std::string& outputPath) override {
+        const auto jpeg = BaselineJpegReader<T>::read(inputPath);
+        // the stream is sized from the pixels, the copied segments (e.g. thumbnails) come on top of them
+        const unsigned int segmentRows = static_cast<unsigned int>(jpeg->segmentBytes() / (24 * jpeg->width)) + 1;
+        stream = std::make_unique<Stream>(outputPath, jpeg->width, jpeg->height + segmentRows);
+        processor.reoptimiseImage(*jpeg, *stream);
+    }
+
+    void setQuality(const int quality) override {
+        processor.setQuality(quality);
+    }
+
+    void setTrellis(const bool enabled) override {
+        processor.trellis = enabled;
+    }
+
+    void setRestartInterval(const unsigned int interval) override {
+        processor.restartInterval = interval;
+    }
+
+    void setStandardTables(const bool enabled) override {
+        processor.standardTables = enabled;
+    }
+
+    void setCoefficientScan(const bool enabled) override {
+        processor.coefficientScan = enabled;
+    }
+
+    void setSampleRows(const unsigned int rows) override {
+        processor.sampleRows = rows;
+    }
+
+    void setProfile(std::shared_ptr<const HuffmanTableProfile> profile) override {
+        processor.profile = std::move(profile);
+    }
+
+    void setArithmeticCoding(const bool enabled) override {
+        processor.arithmeticCoding = enabled;
+    }
+
+    void setScanScript(std::shared_ptr<const ScanScript> script) override {
+        processor.scanScript = std::move(script);
+    }
+
+    EncodedSizePrediction predictSize(BlockwiseRawImage& image) override {
+        return processor.predictSize(image);
+    }
+};
+
+/**
+ * Every combination of transform, Huffman tree builder and bit stream is compiled as its own SpecialisedEncoderEngine,
+ * so the virtual call happens once per image and the pipeline itself stays fully inlined. The engines are named
+ * transform-tree-stream, e.g. separated-iso-seb.
+ */
+class EncoderRegistry {
+public:
+    using Factory = std::unique_ptr<EncoderEngine> (*)();
+
+    struct Entry {
+        std::string name;
+        Factory create;
+    };
+
+    static constexpr const char* defaultEngine = "separated-iso-seb";
+
+    static const std::vector<Entry>& engines() {
+        static const std::vector<Entry> entries = buildEntries();
+        return entries;
+    }
+
+    static std::unique_ptr<EncoderEngine> create(const std::string& name) {
+        for (const auto& entry : engines()) {
+            if (entry.name == name) {
+                return entry.create();
+            }
+        }
+        throw std::invalid_argument("Unknown encoder engine: " + name);
+    }
+
+private:
+    using IsoTree = HuffmanTreeIsoSort<256, uint8_t, uint32_t, uint8_t, 16>;
+    using SortTree = HuffmanTreeSort<256, uint8_t, uint32_t, uint8_t, 16>;
+    using MoffatTree = HuffmanTreeMoffat<256, uint8_t, uint32_t, uint8_t, 16>;
+    using PackageMergeTree = HuffmanTreePackageMerge<256, uint8_t, uint32_t, uint8_t, 16>;
+
+    template<typename Transform, typename HT, typename Stream>
+    static std::unique_ptr<EncoderEngine> createEngine() {
+        return std::make_unique<SpecialisedEncoderEngine<float, Transform, HT, Stream>>();
+    }
+
+    template<typename Transform, typename HT>
+    static void addStreams(std::vector<Entry>& entries, const std::string& name) {
+        entries.push_back({ name + "-seb", &createEngine<Transform, HT, BitStreamSeb> });
+        entries.push_back({ name + "-deinzer", &createEngine<Transform, HT, BitStreamDeinzer> });
+        entries.push_back({ name + "-accumulator", &createEngine<Transform, HT, BitStreamAccumulator> });
+    }
+
+    template<typename Transform>
+    static void addTrees(std::vector<Entry>& entries, const std::string& name) {
+        addStreams<Transform, IsoTree>(entries, name + "-iso");
+        addStreams<Transform, SortTree>(entries, name + "-sort");
+        addStreams<Transform, MoffatTree>(entries, name + "-moffat");
+        addStreams<Transform, PackageMergeTree>(entries, name + "-packagemerge");
+    }
+
+    static std::vector<Entry> buildEntries() {
+        std::vector<Entry> entries;
+        addTrees<SeparatedCosinusTransform<float>>(entries, "separated");
+        addTrees<DirectCosinusTransform<float>>(entries, "direct");
+        addTrees<AraiSimdSimple<float>>(entries, "arai");
+        addTrees<LoefflerSimd<float>>(entries, "loeffler");
+        addTrees<LoefflerSimd<int32_t>>(entries, "loeffler-int");
+        return entries;
+    }
+};
+
+#endif //MEDIENINFO_ENCODERREGISTRY_H
@@ -1,20 +1,32 @@
 #ifndef MEDIENINFO_ENCODINGPROCESSOR_H
 #define MEDIENINFO_ENCODINGPROCESSOR_H
 
+#include <algorithm>
 #include <thread>
+#include <memory>
+#include <stdexcept>
 #include "Image.h"
 #include "dct/AbstractCosinusTransform.h"
 #include "SampledWriter.h"
+#include "StandardHuffmanTables.h"
+#include "HuffmanTableProfile.h"
+#include "SizePrediction.h"
+#include "ArithmeticEncoder.h"
+#include "ProgressiveEncoder.h"
+#include "JpegReader.h"
 #include "BitStream.h"
 #include "segments/DQT.h"
 #include "segments/DHT.h"
 #include "segments/APP0.h"
 #include "segments/SOF0.h"
 #include "segments/SOS.h"
+#include "segments/DRI.h"
+#include "segments/DAC.h"
 #include "HuffmenTreeSorts/HuffmanTreeIsoSort.h"
 #include "HuffmenTreeSorts/HuffmanTreeSort.h"
 #include "HuffmenTreeSorts/NoopHuffman.h"
 #include "helper/ParallelFor.h"
+#include "helper/SpscQueue.h"
 
 template<typename  T>
 class EncodingProcessor {
@@ -70,59 +82,95 @@ public:
 private:
     template <typename Transform>
     inline void processRowBlock(typename Block<T>::rowBlock& block, OffsetSampledWriter<T>& output, Transform& transform, const unsigned int offset) const {
-        //void transformBlock(rowBlock& block, const std::function<void (CoordType, CoordType, T&)>& set)
-        transform.template transformBlock<unsigned int>(block, [offset, &output](const unsigned int x, const unsigned int y, const T v) {
-            output.set(v, offset, x, y);
+        // collect the coefficients in a tile ([v][u] like the block) so they are quantised and reordered at once
+        typename Block<T>::rowBlock tile;
+        transform.template transformBlock<unsigned int>(block, [&tile](const unsigned int x, const unsigned int y, const T v) {
+            tile[y][x] = v;
         });
+        output.setTile(tile, offset);
     }
 
 };
 
-template<typename T, typename Transform>
+/**
+ * Encodes a whole image. The transform, the Huffman tree builder and the bit stream are template parameters so every
+ * combination is compiled (and inlined) separately, EncoderRegistry.h selects one of them at runtime.
+ */
+template<typename T, typename Transform,
+        typename HT = HuffmanTreeIsoSort<256, uint8_t, uint32_t, uint8_t, 16>,
+        typename Stream = BitStream>
 class ImageProcessor {
+private:
+    using HuffmanEncoder = IsoHuffmanEncoder<256, uint8_t, 16>;
+    using ScanWriter = ProgressiveScanWriter<T, HT, Stream>;
+
 public:
-    using HT = HuffmanTreeIsoSort<256, uint8_t, uint32_t, uint8_t, 16>;
-    //using HT = NoopHuffman<256, uint8_t, uint32_t, uint8_t, 16>;
-//    using HT = HuffmanTreeSort<256, uint8_t, uint32_t, uint8_t, 16>;
     ImageProcessor() = default;
     ParallelFor<4> pFor;
 
-    void processImage(BlockwiseRawImage& image, BitStream& writer) {
-        writeMetadataHeaders(image.width, image.height, writer);
-        const EncodingProcessor<T> encodingProcessor;
-        OffsetSampledWriter<T> Y(image.blockAmount * 4, luminaceOnePlus5),
-            Cb(image.blockAmount, chrominaceOnePlus5),
-            Cr(image.blockAmount, chrominaceOnePlus5);
-        Transform transform;
-
-        // read the asynchronously written blocks
-        int rowsReady = 0, rowsProcessed = 0, blockOffset = 0;
-        while(rowsProcessed < image.blockHeight) {
-
-            // wait for new rows
-            while(rowsReady == rowsProcessed) {
-                image.getProcessedRowCount(rowsReady);
-            }
-
-            const int prevStop = blockOffset;
-            const int nextStop = blockOffset + image.blockRowWidth * (rowsReady - rowsProcessed);
-
-            for(; blockOffset < nextStop; ++blockOffset) {
-                encodingProcessor.template processBlock<Transform>(image.blocks[blockOffset], Y, Cb, Cr, transform, blockOffset);
-            }
-
-            Y.partialRunLengthEncoding(prevStop * 4, blockOffset * 4);
-            Cb.partialRunLengthEncoding(prevStop, blockOffset);
-            Cr.partialRunLengthEncoding(prevStop, blockOffset);
+    QuantisationTable luminanceTable = luminaceOnePlus5, chrominanceTable = chrominaceOnePlus5;
+    // requantise rate-distortion optimised after the statistics of the plain quantisation are known
+    bool trellis = false;
+    // MCUs between two restart markers, 0 writes none. With restart markers the scan is entropy coded in parallel.
+    unsigned int restartInterval = 0;
+    // encode in a single pass with the Annex K Huffman tables instead of optimised ones
+    bool standardTables = false;
+    // the first pass only counts the symbol statistics, the scan is entropy coded straight from the coefficients
+    bool coefficientScan = false;
+    // build the tables from every sampleRows-th row of MCUs and stream the scan, 0 uses the statistics of all MCUs
+    unsigned int sampleRows = 0;
+    // trained tables for a single pass, used instead of the statistics of the image when set
+    std::shared_ptr<const HuffmanTableProfile> profile;
+    // write a progressive image (SOF2) with these scans instead of a single sequential scan
+    std::shared_ptr<const ScanScript> scanScript;
+    // code the scan with the adaptive arithmetic coder (SOF9) instead of Huffman tables, in a single pass
+    bool arithmeticCoding = false;
+    // entropy code the streamed scans (standard tables, profile, sampled rows, arithmetic) on a second thread, needs a
+    // second core
+    bool pipelinedScan = std::thread::hardware_concurrency() > 1;
+
+    /**
+     * Replaces the tables with the Annex K tables scaled to the IJG quality (1..100).
+     */
+    void setQuality(const int quality) {
+        luminanceTable = scaleQuantisationTable(annexKLuminance, quality);
+        chrominanceTable = scaleQuantisationTable(annexKChrominance, quality);
+    }
 
-            rowsProcessed = rowsReady;
+    void processImage(BlockwiseRawImage& image, Stream& writer) {
+        checkOptions();
+        if (scanScript) {
+            processImageProgressive(image, writer);
+            return;
+        }
+        if (arithmeticCoding) {
+            processImageArithmetic(image, writer);
+            return;
+        }
+        if (standardTables) {
+            processImageSinglePass(image, writer);
+            return;
+        }
+        if (profile) {
+            processImageWithProfile(image, writer);
+            return;
+        }
+        if (sampleRows != 0) {
+            processImageSampled(image, writer);
+            return;
         }
 
-
-
-        //Y.runLengthEncoding();
-        //Cb.runLengthEncoding();
-        //Cr.runLengthEncoding();
+        writeMetadataHeaders(image.width, image.height, writer);
+        const Quantiser luminance(luminanceTable), chrominance(chrominanceTable);
+        OffsetSampledWriter<T> Y(image.blockAmount * 4, luminance),
+            Cb(image.blockAmount, chrominance),
+            Cr(image.blockAmount, chrominance);
+        if (coefficientScan) {
+            Y.countSymbolsOnly();
+            Cb.countSymbolsOnly();
+            Cr.countSymbolsOnly();
+        }
+        runLengthEncodeImage(image, Y, Cb, Cr, trellis);
 
         HT y_ac;
         y_ac.sortTree(Y.huffweight_ac);
@@ -142,29 +190,423 @@ public:
         c_dc.writeSegmentToStream(writer, 1, 0);
         const auto c_dc_enc = c_dc.generateEncoder();
 
+        if (restartInterval != 0) {
+            DRI dri(static_cast<uint16_t>(restartInterval));
+            _write_segment_ref(writer, dri);
+        }
+
         SOS sos;
         _write_segment_ref(writer, sos);
 
-        const auto rowWidth2 = image.blockRowWidth * 2;
-        StreamWriter<T> wy (Y, y_ac_enc, y_dc_enc, writer, static_cast<const uint32_t>(image.blockRowWidth * 2));
-        StreamWriter<T> wcb (Cb, c_ac_enc, c_dc_enc, writer, image.blockRowWidth);
-        StreamWriter<T> wcr (Cr, c_ac_enc, c_dc_enc, writer, image.blockRowWidth);
+        writeScan(pFor, Y, Cb, Cr, y_ac_enc, y_dc_enc, c_ac_enc, c_dc_enc, image.blockRowWidth, image.blockAmount, writer);
+        writeEOI(writer);
+    }
 
-        int i = 0;
-        do {
-            wy.writeBlock();
-            wy.writeBlock();
-            wy.writeBlock();
-            wy.writeBlock();
-            wcb.writeBlock();
-            wcr.writeBlock();
-        } while (++i < image.blockAmount);
+    /**
+     * Predicts the size processImage would write with the current settings, without writing any bits. The image is
+     * transformed and run length encoded once more to count the symbols.
+     */
+    EncodedSizePrediction predictSize(BlockwiseRawImage& image) const {
+        if (arithmeticCoding || scanScript) {
+            throw std::invalid_argument("The size can only be predicted for a sequential scan with Huffman tables");
+        }
+        checkOptions();
+
+        const Quantiser luminance(luminanceTable), chrominance(chrominanceTable);
+        OffsetSampledWriter<T> Y(image.blockAmount * 4, luminance),
+            Cb(image.blockAmount, chrominance),
+            Cr(image.blockAmount, chrominance);
+        Y.countSymbolsOnly();
+        Cb.countSymbolsOnly();
+        Cr.countSymbolsOnly();
+        runLengthEncodeImage(image, Y, Cb, Cr, trellis);
+
+        std::array<uint32_t, 256> c_ac_counts, c_dc_counts;
+        for (unsigned int i = 0; i < 256; ++i) {
+            c_ac_counts[i] = Cb.huffweight_ac[i] + Cr.huffweight_ac[i];
+            c_dc_counts[i] = Cb.huffweight_dc[i] + Cr.huffweight_dc[i];
+        }
+
+        EncodedSizePrediction prediction;
+        // SOI and EOI
+        prediction.headerBytes = 4 + sizeof(APP0) + sizeof(FullDQT) + sizeof(SOF0) + sizeof(SOS);
+        if (restartInterval != 0) {
+            prediction.headerBytes += sizeof(DRI);
+            prediction.intervals = (image.blockAmount + restartInterval - 1) / restartInterval;
+            prediction.markerBytes = 2 * (prediction.intervals - 1);
+        }
+
+        if (standardTables) {
+            prediction.addTable(annexKLuminanceAc.bits, annexKLuminanceAc.huffval, Y.huffweight_ac, true);
+            prediction.addTable(annexKLuminanceDc.bits, annexKLuminanceDc.huffval, Y.huffweight_dc, false);
+            prediction.addTable(annexKChrominanceAc.bits, annexKChrominanceAc.huffval, c_ac_counts, true);
+            prediction.addTable(annexKChrominanceDc.bits, annexKChrominanceDc.huffval, c_dc_counts, false);
+            return prediction;
+        }
+        if (profile) {
+            prediction.addTable(profile->y_ac.bits, profile->y_ac.huffval, Y.huffweight_ac, true);
+            prediction.addTable(profile->y_dc.bits, profile->y_dc.huffval, Y.huffweight_dc, false);
+            prediction.addTable(profile->c_ac.bits, profile->c_ac.huffval, c_ac_counts, true);
+            prediction.addTable(profile->c_dc.bits, profile->c_dc.huffval, c_dc_counts, false);
+            return prediction;
+        }
+
+        // the tables are built like processImageSampled or processImage do
+        SymbolHistograms tableCounts;
+        if (sampleRows != 0) {
+            tableCounts = collectHistograms(image, sampleRows);
+            tableCounts.addSmoothingFloor();
+        } else {
+            tableCounts.y_ac = Y.huffweight_ac;
+            tableCounts.y_dc = Y.huffweight_dc;
+            tableCounts.c_ac = c_ac_counts;
+            tableCounts.c_dc = c_dc_counts;
+        }
+
+        HT y_ac, y_dc, c_ac, c_dc;
+        y_ac.sortTree(tableCounts.y_ac);
+        y_dc.sortTree(tableCounts.y_dc);
+        c_ac.sortTree(tableCounts.c_ac);
+        c_dc.sortTree(tableCounts.c_dc);
+        prediction.addTable(y_ac.bits, y_ac.huffval, Y.huffweight_ac, true);
+        prediction.addTable(y_dc.bits, y_dc.huffval, Y.huffweight_dc, false);
+        prediction.addTable(c_ac.bits, c_ac.huffval, c_ac_counts, true);
+        prediction.addTable(c_dc.bits, c_dc.huffval, c_dc_counts, false);
+        return prediction;
+    }
+
+    /**
+     * Encodes with the Annex K Huffman tables, so every row of MCUs is written out as soon as it is transformed. Only
+     * the coefficients of one row are kept and no statistics are gathered, the trellis quantisation is not available.
+     */
+    void processImageSinglePass(BlockwiseRawImage& image, Stream& writer) {
+        writeMetadataHeaders(image.width, image.height, writer);
+        DHT::write<16>(writer, 2, 1, annexKLuminanceAc.bits, annexKLuminanceAc.huffval);
+        DHT::write<16>(writer, 0, 0, annexKLuminanceDc.bits, annexKLuminanceDc.huffval);
+        DHT::write<16>(writer, 3, 1, annexKChrominanceAc.bits, annexKChrominanceAc.huffval);
+        DHT::write<16>(writer, 1, 0, annexKChrominanceDc.bits, annexKChrominanceDc.huffval);
+
+        streamScan(image, writer, annexKLuminanceAcEncoder, annexKLuminanceDcEncoder,
+                   annexKChrominanceAcEncoder, annexKChrominanceDcEncoder);
+    }
 
+    /**
+     * Builds the Huffman tables from the statistics of every sampleRows-th row of MCUs and streams the scan like
+     * processImageSinglePass. The sampled rows are transformed twice, but only the coefficients of one row are kept.
+     */
+    void processImageSampled(BlockwiseRawImage& image, Stream& writer) {
+        writeMetadataHeaders(image.width, image.height, writer);
+
+        SymbolHistograms histograms = collectHistograms(image, sampleRows);
+        histograms.addSmoothingFloor();
+
+        HT y_ac;
+        y_ac.sortTree(histograms.y_ac);
+        y_ac.writeSegmentToStream(writer, 2, 1);
+        HT y_dc;
+        y_dc.sortTree(histograms.y_dc);
+        y_dc.writeSegmentToStream(writer, 0, 0);
+        HT c_ac;
+        c_ac.sortTree(histograms.c_ac);
+        c_ac.writeSegmentToStream(writer, 3, 1);
+        HT c_dc;
+        c_dc.sortTree(histograms.c_dc);
+        c_dc.writeSegmentToStream(writer, 1, 0);
+
+        streamScan(image, writer, y_ac.generateEncoder(), y_dc.generateEncoder(), c_ac.generateEncoder(), c_dc.generateEncoder());
+    }
+
+    /**
+     * Encodes in a single pass with the tables of the trained profile.
+     */
+    void processImageWithProfile(BlockwiseRawImage& image, Stream& writer) {
+        writeMetadataHeaders(image.width, image.height, writer);
+        DHT::write<16>(writer, 2, 1, profile->y_ac.bits, profile->y_ac.huffval);
+        DHT::write<16>(writer, 0, 0, profile->y_dc.bits, profile->y_dc.huffval);
+        DHT::write<16>(writer, 3, 1, profile->c_ac.bits, profile->c_ac.huffval);
+        DHT::write<16>(writer, 1, 0, profile->c_dc.bits, profile->c_dc.huffval);
+
+        streamScan(image, writer, HuffmanEncoder(profile->y_ac.bits, profile->y_ac.huffval),
+                   HuffmanEncoder(profile->y_dc.bits, profile->y_dc.huffval),
+                   HuffmanEncoder(profile->c_ac.bits, profile->c_ac.huffval),
+                   HuffmanEncoder(profile->c_dc.bits, profile->c_dc.huffval));
+    }
+
+    /**
+     * Codes the scan with the QM-coder of ISO/IEC 10918-1 Annex D. The statistics adapt while coding, so like
+     * processImageSinglePass every row of MCUs is written out as soon as it is transformed and the trellis quantisation
+     * is not available. The DAC segment states the default conditioning ArithmeticBlockWriter uses.
+     */
+    void processImageArithmetic(BlockwiseRawImage& image, Stream& writer) {
+        using BlockWriter = ArithmeticBlockWriter<T, Stream>;
+        writeMetadataHeaders(image.width, image.height, writer, SOF0::arithmetic);
+
+        DAC dac(BlockWriter::dcLower, BlockWriter::dcUpper, BlockWriter::acThreshold);
+        _write_segment_ref(writer, dac);
+        if (restartInterval != 0) {
+            DRI dri(static_cast<uint16_t>(restartInterval));
+            _write_segment_ref(writer, dri);
+        }
+
+        SOS sos;
+        _write_segment_ref(writer, sos);
+
+        auto rows = createScanRows(image.blockRowWidth);
+        QmEncoder<Stream> coder(writer);
+        // Cb and Cr share the conditioning tables 1 and 3
+        ArithmeticStatistics luminanceStatistics, chrominanceStatistics;
+        BlockWriter wy(rows[0]->Y, coder, luminanceStatistics);
+        BlockWriter wcb(rows[0]->Cb, coder, chrominanceStatistics);
+        BlockWriter wcr(rows[0]->Cr, coder, chrominanceStatistics);
+
+        streamRows(image, rows, [&](const ScanRow& row) {
+            wy.setChannel(row.Y);
+            wcb.setChannel(row.Cb);
+            wcr.setChannel(row.Cr);
+
+            const unsigned int rowStart = row.row * image.blockRowWidth;
+            for(int i = 0; i < image.blockRowWidth; ++i) {
+                const unsigned int mcu = rowStart + i;
+                if (restartInterval != 0 && mcu != 0 && mcu % restartInterval == 0) {
+                    // every interval is terminated and starts with fresh statistics
+                    coder.finish();
+                    writer.writeByteAligned(0xFF);
+                    writer.writeByteAligned(static_cast<uint8_t>(0xD0 + ((mcu / restartInterval - 1) & 7)));
+                    luminanceStatistics.reset();
+                    chrominanceStatistics.reset();
+                    wy.resetPrediction();
+                    wcb.resetPrediction();
+                    wcr.resetPrediction();
+                }
+
+                wy.writeBlock(i * 4);
+                wy.writeBlock(i * 4 + 1);
+                wy.writeBlock(i * 4 + 2);
+                wy.writeBlock(i * 4 + 3);
+                wcb.writeBlock(i);
+                wcr.writeBlock(i);
+            }
+        });
+
+        coder.finish();
+        writeEOI(writer);
+    }
+
+    /**
+     * Writes a progressive image with the scans of scanScript, which need all quantised coefficients of the image. The
+     * scans are written in parallel by writeProgressiveScans, restart markers are not written.
+     */
+    void processImageProgressive(BlockwiseRawImage& image, Stream& writer) {
+        writeMetadataHeaders(image.width, image.height, writer, SOF0::progressive);
+
+        const Quantiser luminance(luminanceTable), chrominance(chrominanceTable);
+        OffsetSampledWriter<T> Y(image.blockAmount * 4, luminance),
+            Cb(image.blockAmount, chrominance),
+            Cr(image.blockAmount, chrominance);
+        Y.countSymbolsOnly();
+        Cb.countSymbolsOnly();
+        Cr.countSymbolsOnly();
+        runLengthEncodeImage(image, Y, Cb, Cr, trellis);
+
+        writeProgressiveScans(ScanWriter::sampledComponents(Y, Cb, Cr, image.width, image.height), image.blockRowWidth,
+                              image.blockHeight, scanScript->scans, image.width, image.height, writer);
+        writeEOI(writer);
+    }
+
+    /**
+     * Writes the coefficients of a decoded baseline JPEG again, as a sequential scan with optimised Huffman tables or
+     * as a progressive image with scanScript, so the decoded pixels stay exactly the same. The quantisation tables,
+     * the frame header and the APPn and COM segments are copied. The first component gets the luminance tables, all
+     * others share the chrominance tables like in processImage. The restart interval of the input is kept unless
+     * restartInterval is set, progressive images have none.
+     */
+    void reoptimiseImage(JpegCoefficients<T>& jpeg, Stream& writer) {
+        if (arithmeticCoding) {
+            throw std::invalid_argument("Re-optimised images are only written with Huffman tables");
+        }
+        if (scanScript && restartInterval != 0) {
+            throw std::invalid_argument("Progressive images are written without restart markers");
+        }
+
+        writer.writeByteAligned(0xFF);
+        writer.writeByteAligned(0xD8);
+        for (const auto& segment : jpeg.segments) {
+            const uint16_t length = static_cast<uint16_t>(segment.payload.size() + 2);
+            writer.writeByteAligned(0xFF);
+            writer.writeByteAligned(segment.marker == 0xC0 && scanScript ? static_cast<uint8_t>(SOF0::progressive) : segment.marker);
+            writer.writeByteAligned(static_cast<uint8_t>(length >> 8));
+            writer.writeByteAligned(static_cast<uint8_t>(length));
+            writer.writeBytes(segment.payload.data(), segment.payload.size());
+        }
+
+        const size_t componentAmount = jpeg.components.size();
+        const auto tableOf = [](const size_t component) { return static_cast<uint8_t>(component == 0 ? 0 : 1); };
+
+        if (scanScript) {
+            std::vector<typename ScanWriter::Component> components;
+            for (size_t i = 0; i < componentAmount; ++i) {
+                const auto& component = jpeg.components[i];
+                components.push_back({ component.channel.get(), component.id, tableOf(i), component.H, component.V,
+                                       component.blocksWide, component.blocksHigh });
+            }
+            // the scan scripts are written for YCbCr, other images get the standard script for their components
+            const ScanScript script = componentAmount == ScanScript::componentAmount
+                    ? *scanScript : ScanScript::standard(static_cast<unsigned int>(componentAmount));
+            writeProgressiveScans(components, jpeg.mcuRowWidth, jpeg.mcuRows, script.scans, jpeg.width, jpeg.height, writer);
+            writeEOI(writer);
+            return;
+        }
+
+        const unsigned int interval = restartInterval != 0 ? restartInterval : jpeg.restartInterval;
+        std::array<std::array<uint32_t, 256>, 2> dcCounts {}, acCounts {};
+        for (size_t i = 0; i < componentAmount; ++i) {
+            auto& component = jpeg.components[i];
+            component.channel->setRestartInterval(interval * component.H * component.V);
+            component.channel->clearRunLengthEncoding();
+            component.channel->runLengthEncoding();
+            for (unsigned int symbol = 0; symbol < 256; ++symbol) {
+                dcCounts[tableOf(i)][symbol] += component.channel->huffweight_dc[symbol];
+                acCounts[tableOf(i)][symbol] += component.channel->huffweight_ac[symbol];
+            }
+        }
+
+        std::array<std::unique_ptr<HuffmanEncoder>, 2> dcEncoders, acEncoders;
+        for (uint8_t t = 0; t < std::min<size_t>(componentAmount, 2); ++t) {
+            HT dc;
+            dc.sortTree(dcCounts[t]);
+            dc.writeSegmentToStream(writer, t, 0);
+            dcEncoders[t] = std::make_unique<HuffmanEncoder>(dc.generateEncoder());
+            HT ac;
+            ac.sortTree(acCounts[t]);
+            ac.writeSegmentToStream(writer, t, 1);
+            acEncoders[t] = std::make_unique<HuffmanEncoder>(ac.generateEncoder());
+        }
+
+        if (interval != 0) {
+            DRI dri(static_cast<uint16_t>(interval));
+            _write_segment_ref(writer, dri);
+        }
+
+        std::vector<uint8_t> ids, tables;
+        std::vector<CoefficientStreamWriter<T, Stream>> blockWriters;
+        for (size_t i = 0; i < componentAmount; ++i) {
+            const uint8_t t = tableOf(i);
+            ids.push_back(jpeg.components[i].id);
+            tables.push_back(static_cast<uint8_t>((t << 4) | t));
+            blockWriters.emplace_back(*jpeg.components[i].channel, *acEncoders[t], *dcEncoders[t], writer);
+        }
+        SOS::write(writer, ids, tables, 0, 63, 0, 0);
+
+        const uint32_t mcus = jpeg.mcuRowWidth * jpeg.mcuRows;
+        for (uint32_t mcu = 0; mcu < mcus; ++mcu) {
+            if (interval != 0 && mcu != 0 && mcu % interval == 0) {
+                writer.fillByte();
+                writer.writeByteAligned(0xFF);
+                writer.writeByteAligned(static_cast<uint8_t>(0xD0 + ((mcu / interval - 1) & 7)));
+                for (auto& blockWriter : blockWriters) {
+                    blockWriter.resetPrediction();
+                }
+            }
+
+            for (size_t i = 0; i < componentAmount; ++i) {
+                const uint32_t blocksPerMcu = jpeg.components[i].H * jpeg.components[i].V;
+                for (uint32_t k = 0; k < blocksPerMcu; ++k) {
+                    blockWriters[i].writeBlock(mcu * blocksPerMcu + k);
+                }
+            }
+        }
         writer.fillByte();
         writeEOI(writer);
     }
 
-    void writeMetadataHeaders(const unsigned int width, const unsigned int height, BitStream& bs) {
+    /**
+     * Counts the symbols of every rowStep-th row of MCUs with the current quantisation tables. Only the coefficients of
+     * one row are kept, the DC prediction starts at 0 in every row.
+     */
+    SymbolHistograms collectHistograms(BlockwiseRawImage& image, const unsigned int rowStep) const {
+        const EncodingProcessor<T> encodingProcessor;
+        const Quantiser luminance(luminanceTable), chrominance(chrominanceTable);
+        OffsetSampledWriter<T> Y(image.blockRowWidth * 4, luminance),
+            Cb(image.blockRowWidth, chrominance),
+            Cr(image.blockRowWidth, chrominance);
+        Y.countSymbolsOnly();
+        Cb.countSymbolsOnly();
+        Cr.countSymbolsOnly();
+        Transform transform;
+
+        int rowsReady = 0;
+        for (int row = 0; row < image.blockHeight; row += rowStep) {
+            while (rowsReady <= row) {
+                image.getProcessedRowCount(rowsReady);
+            }
+
+            const unsigned int rowStart = row * image.blockRowWidth;
+            for (int i = 0; i < image.blockRowWidth; ++i) {
+                encodingProcessor.template processBlock<Transform>(image.blocks[rowStart + i], Y, Cb, Cr, transform, i);
+            }
+
+            // the histograms add up over the rows
+            Y.partialRunLengthEncoding(0, image.blockRowWidth * 4);
+            Cb.partialRunLengthEncoding(0, image.blockRowWidth);
+            Cr.partialRunLengthEncoding(0, image.blockRowWidth);
+        }
+
+        // Cb and Cr share the tables
+        SymbolHistograms histograms;
+        histograms.y_ac = Y.huffweight_ac;
+        histograms.y_dc = Y.huffweight_dc;
+        for (unsigned int i = 0; i < 256; ++i) {
+            histograms.c_ac[i] = Cb.huffweight_ac[i] + Cr.huffweight_ac[i];
+            histograms.c_dc[i] = Cb.huffweight_dc[i] + Cr.huffweight_dc[i];
+        }
+        return histograms;
+    }
+
+    /**
+     * Entropy codes all MCUs and leaves the stream byte aligned. With restart intervals every worker writes a range of
+     * intervals (each followed by its RSTn marker) into its own stream, the parts are copied behind each other.
+     */
+    template<int threads>
+    void writeScan(ParallelFor<threads>& parallel,
+                   const OffsetSampledWriter<T>& Y, const OffsetSampledWriter<T>& Cb, const OffsetSampledWriter<T>& Cr,
+                   const HuffmanEncoder& y_ac, const HuffmanEncoder& y_dc, const HuffmanEncoder& c_ac, const HuffmanEncoder& c_dc,
+                   const uint32_t blockRowWidth, const uint32_t mcus, Stream& writer) const {
+        if (restartInterval == 0) {
+            writeMcus(Y, Cb, Cr, y_ac, y_dc, c_ac, c_dc, blockRowWidth, 0, mcus, writer);
+            writer.fillByte();
+            return;
+        }
+
+        const int intervals = static_cast<int>((mcus + restartInterval - 1) / restartInterval);
+        std::array<std::unique_ptr<Stream>, threads> parts;
+
+        parallel.RunP([&](const int first, const int last, const int thread) {
+            const uint32_t firstMcu = first * restartInterval;
+            const uint32_t lastMcu = std::min<uint32_t>(last * restartInterval, mcus);
+            // the buffer size is estimated from the pixels, a MCU covers 16x16
+            auto part = std::make_unique<Stream>("", (lastMcu - firstMcu) * 16, 16);
+
+            for (int interval = first; interval < last; ++interval) {
+                const uint32_t start = interval * restartInterval;
+                writeMcus(Y, Cb, Cr, y_ac, y_dc, c_ac, c_dc, blockRowWidth, start, std::min(start + restartInterval, mcus), *part);
+                part->fillByte();
+
+                if (interval != intervals - 1) {
+                    part->writeByteAligned(0xFF);
+                    part->writeByteAligned(static_cast<uint8_t>(0xD0 + (interval & 7)));
+                }
+            }
+            parts[thread] = std::move(part);
+        }, 0, intervals);
+
+        for (const auto& part : parts) {
+            if (part) {
+                writer.writeBytes(part->data(), part->length());
+            }
+        }
+    }
+    void writeMetadataHeaders(const unsigned int width, const unsigned int height, Stream& bs,
+                              const uint16_t frameMarker = SOF0::baseline) {
         //start of image marker
         bs.writeByteAligned(0xFF);
         bs.writeByteAligned(0xD8);
@@ -174,11 +616,11 @@ public:
         _write_segment_ref(bs, app0);
 
         // DQT
-        FullDQT dqt(luminaceOnePlus5, chrominaceOnePlus5);
+        FullDQT dqt(luminanceTable, chrominanceTable);
         _write_segment_ref(bs, dqt);
 
         // size and channel info
-        SOF0 sof0(height, width);
+        SOF0 sof0(height, width, frameMarker);
         _write_segment_ref(bs, sof0);
 
         return; // for noew
@@ -203,10 +645,284 @@ public:
 
     }
 
-    inline void writeEOI(BitStream& bs) {
+    inline void writeEOI(Stream& bs) {
         bs.writeByteAligned(0xFF);
         bs.writeByteAligned(0xD9);
     }
+
+private:
+    // rejects the combinations in which one of the options would be ignored
+    void checkOptions() const {
+        if (scanScript && arithmeticCoding) {
+            throw std::invalid_argument("Progressive images are only written with Huffman tables");
+        }
+        if (scanScript && restartInterval != 0) {
+            throw std::invalid_argument("Progressive images are written without restart markers");
+        }
+        if (trellis && (standardTables || profile || sampleRows != 0 || arithmeticCoding)) {
+            throw std::invalid_argument("The trellis quantisation needs the statistics of the full image, it can not be "
+                                        "combined with the standard tables, a profile, sampled rows or arithmetic coding");
+        }
+    }
+
+    /**
+     * The first pass over the whole image: transforms the rows as soon as the parser has finished them and run length
+     * encodes them with the restart interval, optionally followed by the trellis quantisation.
+     */
+    void runLengthEncodeImage(BlockwiseRawImage& image, OffsetSampledWriter<T>& Y, OffsetSampledWriter<T>& Cb,
+                              OffsetSampledWriter<T>& Cr, const bool requantise) const {
+        const EncodingProcessor<T> encodingProcessor;
+        if (requantise) {
+            Y.keepRawCoefficients();
+            Cb.keepRawCoefficients();
+            Cr.keepRawCoefficients();
+        }
+        if (restartInterval != 0) {
+            Y.setRestartInterval(restartInterval * 4);
+            Cb.setRestartInterval(restartInterval);
+            Cr.setRestartInterval(restartInterval);
+        }
+        Transform transform;
+
+        // read the asynchronously written blocks
+        int rowsReady = 0, rowsProcessed = 0, blockOffset = 0;
+        while(rowsProcessed < image.blockHeight) {
+
+            // wait for new rows
+            while(rowsReady == rowsProcessed) {
+                image.getProcessedRowCount(rowsReady);
+            }
+
+            const int prevStop = blockOffset;
+            const int nextStop = blockOffset + image.blockRowWidth * (rowsReady - rowsProcessed);
+
+            for(; blockOffset < nextStop; ++blockOffset) {
+                encodingProcessor.template processBlock<Transform>(image.blocks[blockOffset], Y, Cb, Cr, transform, blockOffset);
+            }
+
+            Y.partialRunLengthEncoding(prevStop * 4, blockOffset * 4);
+            Cb.partialRunLengthEncoding(prevStop, blockOffset);
+            Cr.partialRunLengthEncoding(prevStop, blockOffset);
+
+            rowsProcessed = rowsReady;
+        }
+
+        if (requantise) {
+            // Cb and Cr share the tables
+            std::array<uint32_t, 256> chrominanceAc;
+            for (unsigned int i = 0; i < chrominanceAc.size(); ++i) {
+                chrominanceAc[i] = Cb.huffweight_ac[i] + Cr.huffweight_ac[i];
+            }
+
+            Y.trellisQuantisation(Y.huffweight_ac);
+            Cb.trellisQuantisation(chrominanceAc);
+            Cr.trellisQuantisation(chrominanceAc);
+        }
+    }
+
+    /**
+     * The scans are independent of each other, so the worker threads write ranges of them into their own streams,
+     * which are copied together in order like the restart intervals of writeScan.
+     */
+    void writeProgressiveScans(const std::vector<typename ScanWriter::Component>& components, const uint32_t mcuRowWidth,
+                               const uint32_t mcuRows, const std::vector<ScanScript::Scan>& scans,
+                               const unsigned int width, const unsigned int height, Stream& writer) {
+        std::array<std::unique_ptr<Stream>, decltype(pFor)::threadAmount> parts;
+
+        pFor.RunP([&](const int first, const int last, const int thread) {
+            ScanWriter scanWriter(components, mcuRowWidth, mcuRows);
+            // a part never holds more than the whole image
+            auto part = std::make_unique<Stream>("", width, height);
+            for (int scan = first; scan < last; ++scan) {
+                scanWriter.writeScan(scans[scan], *part);
+            }
+            parts[thread] = std::move(part);
+        }, 0, static_cast<int>(scans.size()));
+
+        for (const auto& part : parts) {
+            if (part) {
+                writer.writeBytes(part->data(), part->length());
+            }
+        }
+    }
+
+    // the coefficients of one row of MCUs while it waits for the entropy coding of streamScan
+    struct ScanRow {
+        // the writers only keep a reference to the quantisers
+        const Quantiser luminance, chrominance;
+        OffsetSampledWriter<T> Y, Cb, Cr;
+        unsigned int row = 0;
+
+        ScanRow(const unsigned int blockRowWidth, const QuantisationTable& luminanceTable, const QuantisationTable& chrominanceTable)
+            : luminance(luminanceTable), chrominance(chrominanceTable),
+              Y(blockRowWidth * 4, luminance), Cb(blockRowWidth, chrominance), Cr(blockRowWidth, chrominance) {}
+    };
+
+    // rows transformed ahead of the entropy coding thread
+    static constexpr size_t pipelineRows = 4;
+
+    using ScanRows = std::array<std::unique_ptr<ScanRow>, pipelineRows>;
+
+    ScanRows createScanRows(const unsigned int blockRowWidth) const {
+        ScanRows rows;
+        for (auto& row : rows) {
+            row = std::make_unique<ScanRow>(blockRowWidth, luminanceTable, chrominanceTable);
+        }
+        return rows;
+    }
+
+    /**
+     * Transforms the image row by row into the buffers and hands every row of MCUs to writeRow right away, in order.
+     * With pipelinedScan writeRow runs on its own thread, the rows are handed over in the ring of buffers through two
+     * SPSC queues.
+     */
+    template<typename WriteRow>
+    void streamRows(BlockwiseRawImage& image, ScanRows& rows, const WriteRow& writeRow) const {
+        const EncodingProcessor<T> encodingProcessor;
+        Transform transform;
+
+        const auto transformRow = [&](ScanRow& row, const unsigned int index) {
+            const unsigned int rowStart = index * image.blockRowWidth;
+            for(int i = 0; i < image.blockRowWidth; ++i) {
+                encodingProcessor.template processBlock<Transform>(image.blocks[rowStart + i], row.Y, row.Cb, row.Cr, transform, i);
+            }
+            row.row = index;
+        };
+
+        if (!pipelinedScan) {
+            forEachReadyRow(image, [&](const unsigned int index) {
+                transformRow(*rows[0], index);
+                writeRow(*rows[0]);
+            });
+            return;
+        }
+
+        // freeRows returns the written buffers to the transform, a nullptr in filledRows ends the entropy coding thread
+        SpscQueue<ScanRow*, pipelineRows> filledRows, freeRows;
+        for (auto& row : rows) {
+            freeRows.push(row.get());
+        }
+
+        std::thread entropyCoder([&]() {
+            for (ScanRow* row = filledRows.pop(); row != nullptr; row = filledRows.pop()) {
+                writeRow(*row);
+                freeRows.push(row);
+            }
+        });
+
+        forEachReadyRow(image, [&](const unsigned int index) {
+            ScanRow* row = freeRows.pop();
+            transformRow(*row, index);
+            filledRows.push(row);
+        });
+        filledRows.push(nullptr);
+        entropyCoder.join();
+    }
+
+    /**
+     * Writes the DRI and SOS segments, then streams the rows and entropy codes every row of MCUs right away with the
+     * given tables. Ends with the EOI marker.
+     */
+    void streamScan(BlockwiseRawImage& image, Stream& writer,
+                    const HuffmanEncoder& y_ac, const HuffmanEncoder& y_dc, const HuffmanEncoder& c_ac, const HuffmanEncoder& c_dc) {
+        if (restartInterval != 0) {
+            DRI dri(static_cast<uint16_t>(restartInterval));
+            _write_segment_ref(writer, dri);
+        }
+
+        SOS sos;
+        _write_segment_ref(writer, sos);
+
+        auto rows = createScanRows(image.blockRowWidth);
+        CoefficientStreamWriter<T, Stream> wy(rows[0]->Y, y_ac, y_dc, writer);
+        CoefficientStreamWriter<T, Stream> wcb(rows[0]->Cb, c_ac, c_dc, writer);
+        CoefficientStreamWriter<T, Stream> wcr(rows[0]->Cr, c_ac, c_dc, writer);
+
+        const auto writeRow = [&](const ScanRow& row) {
+            wy.setChannel(row.Y);
+            wcb.setChannel(row.Cb);
+            wcr.setChannel(row.Cr);
+
+            const unsigned int rowStart = row.row * image.blockRowWidth;
+            for(int i = 0; i < image.blockRowWidth; ++i) {
+                const unsigned int mcu = rowStart + i;
+                if (restartInterval != 0 && mcu != 0 && mcu % restartInterval == 0) {
+                    writer.fillByte();
+                    writer.writeByteAligned(0xFF);
+                    writer.writeByteAligned(static_cast<uint8_t>(0xD0 + ((mcu / restartInterval - 1) & 7)));
+                    wy.resetPrediction();
+                    wcb.resetPrediction();
+                    wcr.resetPrediction();
+                }
+
+                wy.writeBlock(i * 4);
+                wy.writeBlock(i * 4 + 1);
+                wy.writeBlock(i * 4 + 2);
+                wy.writeBlock(i * 4 + 3);
+                wcb.writeBlock(i);
+                wcr.writeBlock(i);
+            }
+        };
+
+        streamRows(image, rows, writeRow);
+
+        writer.fillByte();
+        writeEOI(writer);
+    }
+
+    // calls fn with the index of every row of MCUs as soon as the parser has finished it
+    template<typename Fn>
+    static void forEachReadyRow(BlockwiseRawImage& image, const Fn& fn) {
+        int rowsReady = 0, rowsProcessed = 0;
+        while(rowsProcessed < image.blockHeight) {
+
+            // wait for new rows
+            while(rowsReady == rowsProcessed) {
+                image.getProcessedRowCount(rowsReady);
+            }
+
+            for(; rowsProcessed < rowsReady; ++rowsProcessed) {
+                fn(static_cast<unsigned int>(rowsProcessed));
+            }
+        }
+    }
+
+    void writeMcus(const OffsetSampledWriter<T>& Y, const OffsetSampledWriter<T>& Cb, const OffsetSampledWriter<T>& Cr,
+                   const HuffmanEncoder& y_ac, const HuffmanEncoder& y_dc, const HuffmanEncoder& c_ac, const HuffmanEncoder& c_dc,
+                   const uint32_t blockRowWidth, const uint32_t start, const uint32_t stop, Stream& stream) const {
+        if (coefficientScan) {
+            // start is 0 or the first MCU of a restart interval, so the DC prediction starts at 0
+            CoefficientStreamWriter<T, Stream> wy(Y, y_ac, y_dc, stream);
+            CoefficientStreamWriter<T, Stream> wcb(Cb, c_ac, c_dc, stream);
+            CoefficientStreamWriter<T, Stream> wcr(Cr, c_ac, c_dc, stream);
+
+            for (uint32_t mcu = start; mcu < stop; ++mcu) {
+                wy.writeBlock(mcu * 4);
+                wy.writeBlock(mcu * 4 + 1);
+                wy.writeBlock(mcu * 4 + 2);
+                wy.writeBlock(mcu * 4 + 3);
+                wcb.writeBlock(mcu);
+                wcr.writeBlock(mcu);
+            }
+            return;
+        }
+
+        StreamWriter<T, Stream> wy (Y, y_ac, y_dc, stream, blockRowWidth * 2);
+        StreamWriter<T, Stream> wcb (Cb, c_ac, c_dc, stream, blockRowWidth);
+        StreamWriter<T, Stream> wcr (Cr, c_ac, c_dc, stream, blockRowWidth);
+        wy.skip(start * 4);
+        wcb.skip(start);
+        wcr.skip(start);
+
+        for (uint32_t mcu = start; mcu < stop; ++mcu) {
+            wy.writeBlock();
+            wy.writeBlock();
+            wy.writeBlock();
+            wy.writeBlock();
+            wcb.writeBlock();
+            wcr.writeBlock();
+        }
+    }
 };
 
 #endif //MEDIENINFO_ENCODINGPROCESSOR_H
@@ -22,16 +22,63 @@ private:
     std::array<OutputCodeType, 256> lookupTable = {0};
     std::array<CountType, 256> sizeLookupTable = {0};
 
+    // largest amount of extra bits covered by the fused table
+    static constexpr uint8_t fusedMaxSize = 4;
+
+    // code and extra bits of the symbols with at most fusedMaxSize extra bits, the code is in the upper 16 bits and
+    // the total length in the lowest byte, 0 if the combination is longer than 16 bits or the symbol has no code
+    std::array<uint32_t, 16 << (fusedMaxSize + 1)> fusedLookupTable = {0};
+
+    /**
+     * (1 << size) | bits is unique for all sizes up to fusedMaxSize, so the run and the value select the entry.
+     */
+    static constexpr uint32_t fusedIndex(const uint8_t run, const uint8_t size, const uint16_t bits) {
+        return (static_cast<uint32_t>(run) << (fusedMaxSize + 1)) | (1u << size) | bits;
+    }
+
 public:
     IsoHuffmanEncoder(const std::array<CountType, max_tree_depth+1>& bits, const std::vector<InputKeyType>& huffval) {
-        generateEncodingTable(bits, huffval);
+        assert(huffval.size() > 0);
+        assert(std::accumulate(bits.begin(), bits.end(), 0) == huffval.size());
+        assert((*std::max_element(huffval.begin(), huffval.end())) < lookupTable.size());
+
+        generateEncodingTable(bits, huffval.data());
     }
 
-    template <typename InputType>
-    inline void write(BitStream& bs, const InputType it) const {
+    /**
+     * Tables known at compile time, e.g. the ones of Annex K, can be turned into a constexpr encoder.
+     */
+    template<size_t values>
+    constexpr IsoHuffmanEncoder(const std::array<CountType, max_tree_depth+1>& bits, const std::array<InputKeyType, values>& huffval) {
+        generateEncodingTable(bits, huffval.data());
+    }
+
+    template <typename InputType, typename Stream>
+    inline void write(Stream& bs, const InputType it) const {
+        // a symbol without a code would be written as zero bits
+        assert(sizeLookupTable[it] != 0);
         bs.appendU16(lookupTable[it], sizeLookupTable[it]);
     }
 
+    /**
+     * Writes the code of the run/size symbol followed by the size extra bits. Small values take a single append from
+     * the fused table, larger ones are written in two steps.
+     */
+    template <typename Stream>
+    inline void write(Stream& bs, const uint8_t symbol, const uint8_t size, const uint16_t bits) const {
+        if(size <= fusedMaxSize) {
+            const uint32_t entry = fusedLookupTable[fusedIndex(symbol >> 4, size, bits)];
+            if(entry != 0) {
+                bs.appendU16(static_cast<uint16_t>(entry >> 16), static_cast<uint8_t>(entry));
+                return;
+            }
+        }
+
+        write(bs, symbol);
+        if(size != 0)
+            bs.appendU16(bits, size);
+    }
+
 private:
     void generateEncodingTableWithFuckingGotos(const std::array<CountType, max_tree_depth+1>& bits, const std::vector<InputKeyType>& huffval) {
         std::vector<CountType> huffsize(257);
@@ -99,45 +146,40 @@ private:
             goto begin3;
 
     }
-    void generateEncodingTable(const std::array<CountType, max_tree_depth+1>& bits, const std::vector<InputKeyType>& huffval) {
-        assert(huffval.size() > 0);
-        assert(std::accumulate(bits.begin(), bits.end(), 0) == huffval.size());
-        assert((*std::max_element(huffval.begin(), huffval.end())) < lookupTable.size());
-
-        std::vector<CountType> huffsize(huffval.size());
-        std::vector<OutputCodeType> huffcode(huffval.size());
-
-        // generate the code sizes for all values, basically set every bits[n] values to n
-        // this is Generate_size_table in ISO/IEC 10918-1
-        auto voffset = huffsize.begin();
-        for(int i = 1; i < bits.size(); ++i) {
-            // bits is zero-based while our algorithm starts at one bit
-            std::fill(voffset, voffset + bits[i], static_cast<uint8_t>(i));
-            voffset += bits[i];
-        }
-
-        // generate the codes
-        // this is Generate_code_table in ISO/IEC 10918-1
+    /**
+     * Generate_size_table, Generate_code_table and Order_codes of ISO/IEC 10918-1 in one pass: the codes of one length
+     * are consecutive, going to the next length appends a zero bit.
+     */
+    constexpr void generateEncodingTable(const std::array<CountType, max_tree_depth+1>& bits, const InputKeyType* huffval) {
         OutputCodeType code = 0;
-        CountType si = huffsize[0];
-        const auto sz = huffval.size();
-
-        for(int k = 0; k < huffcode.size(); ++k) {
-            if(huffsize[k] != si) {
-                code <<= huffsize[k] - si;
-                si = huffsize[k];
+        uint32_t k = 0;
+
+        // bits is zero-based while the code lengths start at one bit
+        for(uint8_t size = 1; size < bits.size(); ++size) {
+            for(CountType j = 0; j < bits[size]; ++j) {
+                const auto val = huffval[k];
+                lookupTable[val] = code;
+                sizeLookupTable[val] = size;
+                ++code;
+                ++k;
             }
-
-            huffcode[k] = code;
-            ++code;
+            code <<= 1;
         }
 
-        // generate the encoding lookup table
-        // this is Order_codes in ISO/IEC 10918-1
-        for (int l = 0; l < huffval.size(); ++l) {
-            const auto val = huffval[l];
-            lookupTable[val] = huffcode[l];
-            sizeLookupTable[val] = huffsize[l];
+        generateFusedTable();
+    }
+
+    constexpr void generateFusedTable() {
+        for(uint32_t symbol = 0; symbol < lookupTable.size(); ++symbol) {
+            const uint8_t size = symbol & 0x0F;
+            const uint8_t codeSize = sizeLookupTable[symbol];
+            if(size > fusedMaxSize || codeSize == 0 || codeSize + size > 16)
+                continue;
+
+            for(uint16_t bits = 0; bits < (1u << size); ++bits) {
+                const uint32_t pattern = (static_cast<uint32_t>(lookupTable[symbol]) << size) | bits;
+                fusedLookupTable[fusedIndex(symbol >> 4, size, bits)] = (pattern << 16) | (codeSize + size);
+            }
         }
     }
 
@@ -0,0 +1,231 @@
+#ifndef MEDIENINFO_HUFFMANTABLEPROFILE_H
+#define MEDIENINFO_HUFFMANTABLEPROFILE_H
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/**
+ * The symbol histograms of the four Huffman tables of a scan, Cb and Cr are already summed up.
+ */
+struct SymbolHistograms {
+    std::array<uint32_t, 256> y_ac = {0}, y_dc = {0}, c_ac = {0}, c_dc = {0};
+
+    SymbolHistograms& operator+=(const SymbolHistograms& other) {
+        for (unsigned int i = 0; i < 256; ++i) {
+            y_ac[i] += other.y_ac[i];
+            y_dc[i] += other.y_dc[i];
+            c_ac[i] += other.c_ac[i];
+            c_dc[i] += other.c_dc[i];
+        }
+        return *this;
+    }
+
+    /**
+     * True for every symbol a baseline scan can contain: the DC sizes 0..11 and for AC EOB, ZRL and the runs 0..15
+     * with the sizes 1..10.
+     */
+    static bool isScanSymbol(const bool dc, const unsigned int symbol) {
+        if (dc) {
+            return symbol <= 11;
+        }
+        const unsigned int size = symbol & 15;
+        return symbol == 0x00 || symbol == 0xF0 || (size >= 1 && size <= 10);
+    }
+
+    /**
+     * Gives every symbol a baseline scan can contain at least the count 1, so tables built from sampled statistics
+     * still have a code for the symbols that were not seen.
+     */
+    void addSmoothingFloor() {
+        addSmoothingFloor(y_ac, y_dc);
+        addSmoothingFloor(c_ac, c_dc);
+    }
+
+private:
+    static void addSmoothingFloor(std::array<uint32_t, 256>& ac, std::array<uint32_t, 256>& dc) {
+        for (unsigned int symbol = 0; symbol < 256; ++symbol) {
+            if (isScanSymbol(true, symbol)) {
+                dc[symbol] = std::max<uint32_t>(dc[symbol], 1);
+            }
+            if (isScanSymbol(false, symbol)) {
+                ac[symbol] = std::max<uint32_t>(ac[symbol], 1);
+            }
+        }
+    }
+};
+
+/**
+ * A named set of the four Huffman tables (bits and huffval like DHT::write takes them) trained on a corpus, so images
+ * of the same kind can be encoded in a single pass. The profile is stored as text:
+ *
+ *   profile <name>
+ *   quality <IJG quality the corpus was quantised with, 0 for the default tables>
+ *   <table> bits <16 code counts>
+ *   <table> huffval <symbols>
+ *
+ * for the tables y_ac, y_dc, c_ac and c_dc. Lines starting with # are ignored.
+ */
+struct HuffmanTableProfile {
+    struct Table {
+        // bits[0] is unused like in HuffmanTree
+        std::array<uint8_t, 17> bits = {0};
+        std::vector<uint8_t> huffval;
+    };
+
+    std::string name;
+    int quality = 0;
+    Table y_ac, y_dc, c_ac, c_dc;
+
+    /**
+     * Builds the tables with the tree builder HT from the histograms, which must not leave out a symbol that can occur
+     * in the images (see SymbolHistograms::addSmoothingFloor).
+     */
+    template<typename HT>
+    static HuffmanTableProfile train(const std::string& name, const int quality, const SymbolHistograms& histograms) {
+        HuffmanTableProfile profile;
+        profile.name = name;
+        profile.quality = quality;
+        buildTable<HT>(histograms.y_ac, profile.y_ac);
+        buildTable<HT>(histograms.y_dc, profile.y_dc);
+        buildTable<HT>(histograms.c_ac, profile.c_ac);
+        buildTable<HT>(histograms.c_dc, profile.c_dc);
+        return profile;
+    }
+
+    void save(const std::string& path) const {
+        std::ofstream file(path);
+        if (!file) {
+            throw std::runtime_error("Can not write the profile " + path);
+        }
+
+        file << "# Huffman table profile, see HuffmanTableProfile.h\n";
+        file << "profile " << name << "\n";
+        file << "quality " << quality << "\n";
+        writeTable(file, "y_ac", y_ac);
+        writeTable(file, "y_dc", y_dc);
+        writeTable(file, "c_ac", c_ac);
+        writeTable(file, "c_dc", c_dc);
+    }
+
+    static HuffmanTableProfile load(const std::string& path) {
+        std::ifstream file(path);
+        if (!file) {
+            throw std::runtime_error("Can not read the profile " + path);
+        }
+
+        HuffmanTableProfile profile;
+        std::string line;
+        while (std::getline(file, line)) {
+            std::istringstream tokens(line);
+            std::string key;
+            if (!(tokens >> key) || key[0] == '#') {
+                continue;
+            }
+
+            if (key == "profile") {
+                tokens >> profile.name;
+            } else if (key == "quality") {
+                tokens >> profile.quality;
+            } else {
+                std::string field;
+                tokens >> field;
+                readTable(tokens, field, profile.table(key, path), path);
+            }
+        }
+
+        if (!isValid(profile.y_ac, false) || !isValid(profile.y_dc, true)
+            || !isValid(profile.c_ac, false) || !isValid(profile.c_dc, true)) {
+            throw std::runtime_error("The profile " + path + " does not contain four valid tables");
+        }
+        return profile;
+    }
+
+private:
+    template<typename HT>
+    static void buildTable(const std::array<uint32_t, 256>& histogram, Table& table) {
+        HT tree;
+        tree.sortTree(histogram);
+        std::copy(tree.bits.begin(), tree.bits.end(), table.bits.begin());
+        table.huffval.assign(tree.huffval.begin(), tree.huffval.begin() + tree.NodeAmount());
+    }
+
+    Table& table(const std::string& key, const std::string& path) {
+        if (key == "y_ac") return y_ac;
+        if (key == "y_dc") return y_dc;
+        if (key == "c_ac") return c_ac;
+        if (key == "c_dc") return c_dc;
+        throw std::runtime_error("Unknown table " + key + " in the profile " + path);
+    }
+
+    static void writeTable(std::ofstream& file, const std::string& key, const Table& table) {
+        file << key << " bits";
+        for (unsigned int length = 1; length < table.bits.size(); ++length) {
+            file << " " << static_cast<int>(table.bits[length]);
+        }
+        file << "\n" << key << " huffval";
+        for (const auto symbol : table.huffval) {
+            file << " " << static_cast<int>(symbol);
+        }
+        file << "\n";
+    }
+
+    static void readTable(std::istringstream& tokens, const std::string& field, Table& table, const std::string& path) {
+        std::vector<int> values;
+        int value;
+        while (tokens >> value) {
+            if (value < 0 || value > 255) {
+                throw std::runtime_error("Value out of range in the profile " + path);
+            }
+            values.push_back(value);
+        }
+
+        if (field == "bits") {
+            if (values.size() != 16) {
+                throw std::runtime_error("A table needs 16 code counts in the profile " + path);
+            }
+            std::copy(values.begin(), values.end(), table.bits.begin() + 1);
+        } else if (field == "huffval") {
+            table.huffval.assign(values.begin(), values.end());
+        } else {
+            throw std::runtime_error("Unknown field " + field + " in the profile " + path);
+        }
+    }
+
+    /**
+     * The counts have to match the symbols and fit into the code space without the all ones code. Every symbol may
+     * occur once and every symbol of a baseline scan needs a code, the encoder would write nothing for a missing one.
+     */
+    static bool isValid(const Table& table, const bool dc) {
+        size_t amount = 0;
+        uint32_t codes = 0;
+        for (unsigned int length = 1; length < table.bits.size(); ++length) {
+            amount += table.bits[length];
+            codes = (codes << 1) + table.bits[length];
+        }
+        if (amount == 0 || amount != table.huffval.size() || codes >= (1u << 16)) {
+            return false;
+        }
+
+        std::array<bool, 256> coded = {false};
+        for (const auto symbol : table.huffval) {
+            if (coded[symbol]) {
+                return false;
+            }
+            coded[symbol] = true;
+        }
+        for (unsigned int symbol = 0; symbol < 256; ++symbol) {
+            if (SymbolHistograms::isScanSymbol(dc, symbol) && !coded[symbol]) {
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+#endif //MEDIENINFO_HUFFMANTABLEPROFILE_H
@@ -41,19 +41,34 @@ public:
     }
 
     // returns the bits used when the huffman code is used
-    virtual double Efficiency_huffman() const = 0;
+    virtual double Efficiency_huffman() const {
+        double sum = 0;
+        uint32_t k = 0;
+        for (uint32_t length = 1; length <= max_tree_depth; ++length) {
+            for (uint32_t j = 0; j < bits[length]; ++j) {
+                sum += static_cast<double>(amounts[huffval[k++]]) * length;
+            }
+        }
+        return sum;
+    }
 
     // returns the bits used when 8 bit keys are used for every occurence
-    virtual double Efficiency_fullkey() const = 0;
+    virtual double Efficiency_fullkey() const {
+        return 8 * sizeof(InputKeyType) * sumWeight();
+    }
 
     // returns the bits used when bit-amount fitting keys are used for every occurence
-    virtual double Efficiency_logkey() const = 0;
+    virtual double Efficiency_logkey() const {
+        return log2(max_values) * sumWeight();
+    }
 
-    void writeSegmentToStream(BitStream& stream, const uint8_t htinfo) {
+    template<typename Stream>
+    void writeSegmentToStream(Stream& stream, const uint8_t htinfo) {
         DHT::write<max_tree_depth>(stream, htinfo, bits, huffval);
     }
 
-    void writeSegmentToStream(BitStream& stream, const uint8_t tree_num, const uint8_t is_ac) {
+    template<typename Stream>
+    void writeSegmentToStream(Stream& stream, const uint8_t tree_num, const uint8_t is_ac) {
         DHT::write<max_tree_depth>(stream, tree_num, is_ac, bits, huffval);
     }
 
@@ -65,8 +80,53 @@ public:
     }
 
 protected:
+    // the counts passed to the last sortTree call, the default efficiencies are calculated from them
+    std::array<AmountType, max_values> amounts = {};
+
     virtual void sortToLeaves(const std::array<AmountType, max_values> &values) = 0;
 
+    /**
+     * Adjust_BITS of ISO/IEC 10918-1 Annex K.2. lengthCounts (a std::array or std::vector) holds the amount of codes
+     * per length including the one reserved for the all ones pattern, the codes longer than max_tree_depth are moved up
+     * and the reserved one is removed from the longest length. The result is stored in bits.
+     */
+    template<typename Counts>
+    void adjustBits(Counts& lengthCounts) {
+        int i = static_cast<int>(lengthCounts.size()) - 1;
+        while (i > max_tree_depth) {
+            if (lengthCounts[i] > 0) {
+                int j = i - 2;
+                while (lengthCounts[j] <= 0) {
+                    j--;
+                }
+                lengthCounts[i] = lengthCounts[i] - 2;
+                lengthCounts[i - 1] = lengthCounts[i - 1] + 1;
+                lengthCounts[j + 1] = lengthCounts[j + 1] + 2;
+                lengthCounts[j] = lengthCounts[j] - 1;
+            }
+            else {
+                --i;
+            }
+        }
+
+        while (lengthCounts[i] == 0) {
+            i--;
+        }
+        lengthCounts[i] = lengthCounts[i] - 1;
+
+        for (int l = 0; l <= max_tree_depth; ++l) {
+            bits[l] = l < static_cast<int>(lengthCounts.size()) ? lengthCounts[l] : 0;
+        }
+    }
+
+    uint64_t sumWeight() const {
+        uint64_t sum = 0;
+        for (const auto amount : amounts)
+            sum += amount;
+
+        return sum;
+    }
+
     double node_iter(Node<InputKeyType, AmountType> *cur, uint32_t level) const {
         if (cur == nullptr)
             return 0;
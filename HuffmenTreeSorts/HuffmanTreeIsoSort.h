@@ -22,12 +22,14 @@ private:
             leaf->value = i;
             leaf->amount = values[i];
             leaf->next = nullptr;
+            leaf->codesize = 0;
         }
 
         const auto leaf = &leavesISO[leavesISO.size() - 1];
         leaf->value = leavesISO.size() - 1;
         leaf->amount = 1;
         leaf->next = nullptr;
+        leaf->codesize = 0;
     }
 
     void findLowest(
@@ -45,9 +47,9 @@ private:
         set.erase(set.begin());
     }
 
-    void sort_input() {
+    void sort_input(const int longest) {
         int k = 0;
-        for(int i = 1; i <= 32; i++) {
+        for(int i = 1; i <= longest; i++) {
             for(int j = 0; j < (leavesISO.size() - 1); j++) {
                 if (leavesISO.at(j).codesize == i) {
                     //this->huffval.push_back(j); // uneeded since we resized it at the beginning of iso_sort
@@ -57,43 +59,19 @@ private:
         }
     }
 
-    void adjustBits(std::array<uint8_t, 33>& bits) {
-        int i = 32;
-        while (i > max_tree_depth) {
-            if (bits[i] > 0) {
-                int j = i - 1;
-                j--;
-                while (bits[j] <= 0) {
-                    j--;
-                }
-                bits[i] = bits[i] - 2;
-                bits[i - 1] = bits[i - 1] + 1;
-                bits[j + 1] = bits[j + 1] + 2;
-                bits[j] = bits[j] - 1;
-            }
-            else {
-                --i;
-            }
-        }
-
-        while (bits[i] == 0) {
-            i--;
-        }
-        bits[i] = bits[i] - 1;
-        std::memcpy(&this->bits[0], &bits[0], sizeof(this->bits));
-        sort_input();
-    }
-
     void countBits() {
-        std::array<uint8_t , 33> bits = {0};
+        // the standard assumes that a depth greater than 32 will not occur, but skewed counts (e.g. a geometric
+        // distribution) go deeper. A tree of max_values + 1 leaves is at most max_values deep.
+        std::array<uint16_t, max_values + 1> bits = {0};
+        int longest = 0;
         for (int i = 0; i < leavesISO.size(); i++) {
             if (leavesISO[i].codesize != 0) {
-                // the standard assumes that a depth greater than 32 will not occur, but
-                // I do doubt this
                 ++bits.at(leavesISO[i].codesize);
+                longest = std::max(longest, leavesISO[i].codesize);
             }
         }
-        adjustBits(bits);
+        this->adjustBits(bits);
+        sort_input(longest);
     }
 
     void iso_sort() {
@@ -134,25 +112,10 @@ public:
     HuffmanTreeIsoSort() = default;
 
     void sortTree(const std::array<AmountType, max_values> &values) override {
+        this->amounts = values;
         sortToLeaves(values);
         iso_sort();
     }
-
-    double Efficiency_huffman() const override {
-        //TODO: not implemented yet
-        return 0;
-    }
-
-    double Efficiency_fullkey() const override {
-        //TODO: not implemented yet
-        return 0;
-    }
-
-    double Efficiency_logkey() const override {
-        //TODO: not implemented yet
-        return 0;
-    }
-
 };
 
 #endif //MEDIENINFO_HUFFMANTREEISOSORT_H
@@ -0,0 +1,121 @@
+#ifndef MEDIENINFO_HUFFMANTREEMOFFAT_H
+#define MEDIENINFO_HUFFMANTREEMOFFAT_H
+
+#include <array>
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include "HuffmanTree.h"
+
+/**
+ * Computes the code lengths with the in-place algorithm of Moffat and Katajainen ("In-Place Calculation of
+ * Minimum-Redundancy Codes"): the counts are sorted once, then three linear passes over the same array turn them into
+ * parent pointers, node depths and finally leaf depths. There are no tree nodes and no allocations, the lengths are
+ * limited with the Annex K adjustBits like in the other trees.
+ */
+template<uint32_t max_values, typename InputKeyType = uint8_t, typename AmountType = uint32_t, typename OutputKeyType = uint16_t, uint8_t max_tree_depth = 16>
+class HuffmanTreeMoffat: public HuffmanTree<max_values, InputKeyType, AmountType, OutputKeyType, max_tree_depth> {
+private:
+    // one more symbol for the code reserved for the all ones pattern
+    static constexpr uint32_t symbolAmount = max_values + 1;
+    static constexpr uint32_t symbolBits = 9;
+    static_assert(symbolAmount <= (1u << symbolBits), "the symbols have to fit next to the counts in the sort keys");
+
+    // count << symbolBits | symbol in ascending order, the reserved symbol gets the count 0 to be the first
+    std::array<uint64_t, symbolAmount> keys;
+    // the weights, turned into the code lengths in place
+    std::array<uint64_t, symbolAmount> lengths;
+    uint32_t used = 0;
+
+    void sortToLeaves(const std::array<AmountType, max_values> &values) override {
+        used = 0;
+        keys[used++] = max_values;
+        for (uint32_t i = 0; i < max_values; ++i) {
+            if (values[i] != 0) {
+                keys[used++] = (static_cast<uint64_t>(values[i]) << symbolBits) | i;
+            }
+        }
+        std::sort(keys.begin() + 1, keys.begin() + used);
+
+        lengths[0] = 1;
+        for (uint32_t i = 1; i < used; ++i) {
+            lengths[i] = keys[i] >> symbolBits;
+        }
+    }
+
+    /**
+     * calculate_minimum_redundancy of the paper, the weights have to be sorted ascending.
+     */
+    static void minimumRedundancy(uint64_t* A, const int n) {
+        if (n == 1) {
+            A[0] = 0;
+            return;
+        }
+
+        // first pass, left to right, combine the two lightest items and store parent pointers in the internal nodes
+        A[0] += A[1];
+        int root = 0, leaf = 2;
+        for (int next = 1; next < n - 1; ++next) {
+            if (leaf >= n || A[root] < A[leaf]) {
+                A[next] = A[root];
+                A[root++] = next;
+            } else {
+                A[next] = A[leaf++];
+            }
+
+            if (leaf >= n || (root < next && A[root] < A[leaf])) {
+                A[next] += A[root];
+                A[root++] = next;
+            } else {
+                A[next] += A[leaf++];
+            }
+        }
+
+        // second pass, right to left, the depth of every internal node is one more than the one of its parent
+        A[n - 2] = 0;
+        for (int next = n - 3; next >= 0; --next) {
+            A[next] = A[A[next]] + 1;
+        }
+
+        // third pass, right to left, every level has twice the nodes of the one above minus the internal ones
+        int available = 1, usedNodes = 0, depth = 0, next = n - 1;
+        root = n - 2;
+        while (available > 0) {
+            while (root >= 0 && A[root] == static_cast<uint64_t>(depth)) {
+                ++usedNodes;
+                --root;
+            }
+            while (available > usedNodes) {
+                A[next--] = depth;
+                --available;
+            }
+            available = 2 * usedNodes;
+            ++depth;
+            usedNodes = 0;
+        }
+    }
+
+public:
+    HuffmanTreeMoffat() = default;
+
+    void sortTree(const std::array<AmountType, max_values> &values) override {
+        this->amounts = values;
+        sortToLeaves(values);
+        assert(used > 1);
+        minimumRedundancy(lengths.data(), used);
+
+        std::array<uint16_t, symbolAmount> lengthCounts = {0};
+        for (uint32_t i = 0; i < used; ++i) {
+            ++lengthCounts[lengths[i]];
+        }
+        this->adjustBits(lengthCounts);
+
+        // the heaviest symbols get the shortest codes, the reserved one at index 0 is left out
+        this->huffval.resize(used - 1);
+        for (uint32_t i = 1; i < used; ++i) {
+            this->huffval[used - 1 - i] = static_cast<InputKeyType>(keys[i] & ((1u << symbolBits) - 1));
+        }
+    }
+};
+
+#endif //MEDIENINFO_HUFFMANTREEMOFFAT_H
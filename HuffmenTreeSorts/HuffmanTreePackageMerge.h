@@ -0,0 +1,115 @@
+#ifndef MEDIENINFO_HUFFMANTREEPACKAGEMERGE_H
+#define MEDIENINFO_HUFFMANTREEPACKAGEMERGE_H
+
+#include <array>
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include "HuffmanTree.h"
+
+/**
+ * Optimal length limited code lengths with the package-merge algorithm of Larmore and Hirschberg. Every level from the
+ * deepest to the first merges the sorted symbols with the pairs ("packages") of the level below, the 2n - 2 cheapest
+ * items of the first level decide the lengths: a symbol gets one bit for every level on which it is selected. Unlike
+ * adjustBits this never gives away bits when the counts are skewed.
+ * The code reserved for the all ones pattern is a symbol with the count 0, it ends up with the longest length and is
+ * dropped afterwards.
+ */
+template<uint32_t max_values, typename InputKeyType = uint8_t, typename AmountType = uint32_t, typename OutputKeyType = uint16_t, uint8_t max_tree_depth = 16>
+class HuffmanTreePackageMerge: public HuffmanTree<max_values, InputKeyType, AmountType, OutputKeyType, max_tree_depth> {
+private:
+    static constexpr uint32_t symbolAmount = max_values + 1;
+    static constexpr uint32_t symbolBits = 9;
+    static constexpr uint32_t maxItems = 2 * symbolAmount;
+    static_assert(symbolAmount <= (1u << symbolBits), "the symbols have to fit next to the counts in the sort keys");
+
+    // count << symbolBits | symbol in ascending order, the reserved symbol has the count 0
+    std::array<uint64_t, symbolAmount> keys;
+    uint32_t used = 0;
+
+    // weight of every item per level, the flags mark the packages
+    std::array<std::array<uint64_t, maxItems>, max_tree_depth + 1> itemWeights;
+    std::array<std::array<bool, maxItems>, max_tree_depth + 1> isPackage;
+    std::array<uint32_t, max_tree_depth + 1> itemAmount;
+
+    void sortToLeaves(const std::array<AmountType, max_values> &values) override {
+        used = 0;
+        keys[used++] = max_values;
+        for (uint32_t i = 0; i < max_values; ++i) {
+            if (values[i] != 0) {
+                keys[used++] = (static_cast<uint64_t>(values[i]) << symbolBits) | i;
+            }
+        }
+        std::sort(keys.begin() + 1, keys.begin() + used);
+    }
+
+    void packageMerge() {
+        assert(used > 1);
+        assert(used <= (1u << max_tree_depth));
+
+        // the deepest level only has the symbols
+        for (uint32_t i = 0; i < used; ++i) {
+            itemWeights[max_tree_depth][i] = keys[i] >> symbolBits;
+            isPackage[max_tree_depth][i] = false;
+        }
+        itemAmount[max_tree_depth] = used;
+
+        for (int level = max_tree_depth - 1; level >= 1; --level) {
+            const auto& below = itemWeights[level + 1];
+            const uint32_t packages = itemAmount[level + 1] / 2;
+
+            uint32_t symbol = 0, package = 0, k = 0;
+            while (symbol < used || package < packages) {
+                const uint64_t packageWeight = package < packages ? below[2 * package] + below[2 * package + 1] : 0;
+                if (package >= packages || (symbol < used && (keys[symbol] >> symbolBits) <= packageWeight)) {
+                    itemWeights[level][k] = keys[symbol++] >> symbolBits;
+                    isPackage[level][k++] = false;
+                } else {
+                    itemWeights[level][k] = packageWeight;
+                    isPackage[level][k++] = true;
+                    ++package;
+                }
+            }
+            itemAmount[level] = k;
+        }
+
+        // walk down from the first level, the selected packages of a level select twice the items below
+        std::array<uint32_t, symbolAmount> lengths = {0};
+        uint32_t selected = 2 * used - 2;
+        for (uint32_t level = 1; level <= max_tree_depth && selected != 0; ++level) {
+            uint32_t symbols = 0, packages = 0;
+            for (uint32_t k = 0; k < selected; ++k) {
+                if (isPackage[level][k]) {
+                    ++packages;
+                } else {
+                    ++symbols;
+                }
+            }
+
+            // the symbols are merged in ascending order, so the selected ones are always the lightest
+            for (uint32_t i = 0; i < symbols; ++i) {
+                ++lengths[i];
+            }
+            selected = 2 * packages;
+        }
+
+        // the heaviest symbols have the shortest codes, the reserved one at index 0 is left out
+        this->bits.fill(0);
+        this->huffval.resize(used - 1);
+        for (uint32_t i = 1; i < used; ++i) {
+            ++this->bits[lengths[i]];
+            this->huffval[used - 1 - i] = static_cast<InputKeyType>(keys[i] & ((1u << symbolBits) - 1));
+        }
+    }
+
+public:
+    HuffmanTreePackageMerge() = default;
+
+    void sortTree(const std::array<AmountType, max_values> &values) override {
+        this->amounts = values;
+        sortToLeaves(values);
+        packageMerge();
+    }
+};
+
+#endif //MEDIENINFO_HUFFMANTREEPACKAGEMERGE_H
@@ -69,6 +69,8 @@ private:
                     cur->push_back(ptr->left);
                     if(ptr->right != nullptr)
                         cur->push_back(ptr->right);
+                    else
+                        ++vbits[depth + 1]; // the missing child of the dead node is the code reserved for all ones
                 }
             }
 
@@ -81,40 +83,27 @@ private:
         } while(!prev->empty());
 
         // second, do the adjust_bits procedure from ISO
-        // since the order of the nodes will not be changed (and it would not produce errors even if it would), we just
-        // need to push the numbers a bit
-        int i = startNode->level + 1; // basically our max level. Since we start counting at zero, increase it by one
-
-        while (i > max_tree_depth) {
-            if (vbits[i] > 0) {
-                int j = i - 1;
-                j--;
-                while (vbits[j] <= 0) {
-                    j--;
-                }
-                vbits[i] = vbits[i] - 2;
-                vbits[i - 1] = vbits[i - 1] + 1;
-                vbits[j + 1] = vbits[j + 1] + 2;
-                vbits[j] = vbits[j] - 1;
-            }
-            i--;
-        }
+        // since the order of the nodes will not be changed, we just need to push the numbers a bit. The deepest level
+        // can have an odd amount of leaves because of the dead node, counting its missing child as the reserved code
+        // makes every level complete again.
+        this->adjustBits(vbits);
+    }
 
-        // this would remove the padding bit we do not have
-//        while (vbits[i] == 0) {
-//            i--;
-//        }
-//        vbits[i] = vbits[i] - 1;
+    void mergeRemaining(std::multiset<Node<InputKeyType, AmountType> *, NodePtrComp<InputKeyType, AmountType>>& lowest) {
+        while (lowest.size() > 1) {
+            auto newNode = initNode();
 
-        if(vbits.size() >= this->bits.size()) {
-            // the vector is bigger - everything is fine
-            std::memcpy(&this->bits[0], &vbits[0], sizeof(this->bits));
-        }
-        else {
-            // the vectort is smaller, so we need to copy the values and then memset the rest of the array to 0
-            std::memcpy(&this->bits[0], &vbits[0], vbits.size());
-            std::memset(&this->bits[vbits.size()], 0, sizeof(this->bits) - vbits.size());
+            auto fp = lowest.begin();
+            auto sp = ++lowest.begin();
+
+            newNode->setValueSwap(*fp, *sp);
+            lowest.erase(fp);
+            lowest.erase(lowest.begin());
+
+            lowest.insert(newNode);
         }
+
+        startNode = *(lowest.begin());
     }
 
     void sort() {
@@ -124,10 +113,18 @@ private:
         uint32_t leaves_offset = 0;
         while(nodes[leaves_offset].weight == 0)
             ++leaves_offset;
+        assert(leaves_offset < nodes.size());
 
         auto dn = initNode();
         dn->setDeadNode(&nodes[leaves_offset++]);
 
+        if (leaves_offset >= nodes.size()) {
+            // a single symbol, it gets a one bit code next to the reserved one
+            startNode = dn;
+            this->convertToOutput();
+            return;
+        }
+
         auto firstNode = initNode();
         firstNode->setValue(&nodes[leaves_offset++], dn);
 
@@ -137,6 +134,12 @@ private:
 
         do {
 
+            if (leaves_offset >= nodes.size()) {
+                // the last two leaves were paired up, only the inner nodes are left
+                mergeRemaining(lowest);
+                break;
+            }
+
             if (lowest.size() > 1) {
                 auto second = lowest.begin();
                 ++second;
@@ -163,30 +166,9 @@ private:
                 auto begin = lowest.begin();
                 newNode->setValueSwap(&nodes[leaves_offset], *begin);
 
-                if (lowest.size() == 1) {
-                    // that was the last element, we're done
-                    startNode = newNode;
-                } else {
-                    lowest.erase(begin);
-                    lowest.insert(newNode);
-
-                    while (lowest.size() > 1) {
-                        newNode = initNode();
-
-                        auto fp = lowest.begin();
-                        auto sp = ++lowest.begin();
-
-                        newNode->setValueSwap(*fp, *sp);
-                        //lowest.erase(fp, sp);
-                        lowest.erase(fp);
-                        lowest.erase(lowest.begin());
-
-                        lowest.insert(newNode);
-                    }
-
-                    startNode = *(lowest.begin());
-                }
-
+                lowest.erase(begin);
+                lowest.insert(newNode);
+                mergeRemaining(lowest);
                 break;
             }
 
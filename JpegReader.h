@@ -0,0 +1,492 @@
+#ifndef MEDIENINFO_JPEGREADER_H
+#define MEDIENINFO_JPEGREADER_H
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "SampledWriter.h"
+
+/**
+ * The quantised coefficients of a baseline JPEG and the segments that are copied when it is written again.
+ */
+template<typename T>
+struct JpegCoefficients {
+    struct Component {
+        uint8_t id = 0;
+        // blocks per MCU, 1x1 for the single component of a grey image whatever the frame header states
+        uint8_t H = 1, V = 1;
+        uint8_t quantisationTable = 0;
+        // size in blocks without the padding to whole MCUs
+        uint32_t blocksWide = 0, blocksHigh = 0;
+        // the channel only keeps a reference to its quantiser
+        std::unique_ptr<Quantiser> quantiser;
+        // the blocks MCU by MCU, H x V blocks each row by row like in the scan
+        std::unique_ptr<OffsetSampledWriter<T>> channel;
+    };
+
+    // a segment with its payload behind the length field
+    struct Segment {
+        uint8_t marker;
+        std::vector<uint8_t> payload;
+    };
+
+    uint16_t width = 0, height = 0;
+    std::vector<Component> components;
+    uint32_t mcuRowWidth = 0, mcuRows = 0;
+    // MCUs between two restart markers, 0 if there are none
+    uint16_t restartInterval = 0;
+    // APPn, COM, DQT and the frame header in the order of the file
+    std::vector<Segment> segments;
+
+    size_t segmentBytes() const {
+        size_t bytes = 0;
+        for (const Segment& segment : segments) {
+            bytes += 4 + segment.payload.size();
+        }
+        return bytes;
+    }
+};
+
+/**
+ * Entropy decodes a baseline JPEG (SOF0 with a single scan of all components) to its quantised coefficients, without
+ * the inverse transform. The Huffman codes are looked up with their first 9 bits like in libjpeg, longer codes are
+ * found with the largest code of every length (ISO/IEC 10918-1 F.2.2.3). Broken or other JPEGs throw an
+ * invalid_argument like the PPMParser.
+ */
+template<typename T>
+class BaselineJpegReader {
+private:
+    static constexpr ZikZakLookupTable zigzag {};
+    static constexpr unsigned int lookupBits = 9;
+
+    struct HuffmanDecodingTable {
+        bool defined = false;
+        // length << 8 | symbol for all codes of up to lookupBits bits starting with the index, 0 for longer codes
+        std::array<uint16_t, 1 << lookupBits> lookup;
+        // the largest code of every length (-1 without codes) and the offset from a code to its symbol in values
+        std::array<int32_t, 17> maxCode, valueOffset;
+        std::array<uint8_t, 256> values;
+    };
+
+    const uint8_t* data;
+    const size_t length;
+    const std::string name;
+    size_t position = 0;
+
+    std::unique_ptr<JpegCoefficients<T>> jpeg = std::make_unique<JpegCoefficients<T>>();
+    std::array<std::array<int, 64>, 4> quantisationTables;
+    std::array<bool, 4> quantisationDefined = { false, false, false, false };
+    std::array<HuffmanDecodingTable, 4> dcTables, acTables;
+    // the tables the scan selects for every component
+    std::vector<const HuffmanDecodingTable*> scanDcTables, scanAcTables;
+    bool frameRead = false, scanRead = false;
+
+    // the entropy coded data, MSB first. At a marker the buffer is filled up with padding zeros.
+    uint64_t buffer = 0;
+    int bits = 0, padding = 0;
+    bool markerReached = false;
+
+public:
+    static std::unique_ptr<JpegCoefficients<T>> read(const std::string& path) {
+        std::ifstream file(path, std::ios::binary);
+        if (!file) {
+            throw std::invalid_argument("Couldn't open " + path);
+        }
+        const std::vector<uint8_t> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        return read(bytes.data(), bytes.size(), path);
+    }
+
+    static std::unique_ptr<JpegCoefficients<T>> read(const uint8_t* data, const size_t length, const std::string& name) {
+        BaselineJpegReader reader(data, length, name);
+        reader.readSegments();
+        return std::move(reader.jpeg);
+    }
+
+private:
+    BaselineJpegReader(const uint8_t* data, const size_t length, std::string name)
+        : data(data), length(length), name(std::move(name)) {}
+
+    [[noreturn]] void fail(const std::string& reason) const {
+        throw std::invalid_argument(name + " " + reason);
+    }
+
+    void readSegments() {
+        if (length < 4 || data[0] != 0xFF || data[1] != 0xD8) {
+            fail("is not a JPEG");
+        }
+        position = 2;
+
+        for (;;) {
+            // fill bytes may precede a marker
+            while (position < length && data[position] == 0xFF && position + 1 < length && data[position + 1] == 0xFF) {
+                ++position;
+            }
+            if (position + 1 >= length) {
+                // some encoders leave out the EOI marker
+                if (scanRead) {
+                    return;
+                }
+                fail("ends before the scan");
+            }
+            if (data[position] != 0xFF) {
+                fail("has data between the segments");
+            }
+
+            const uint8_t marker = data[position + 1];
+            position += 2;
+            if (marker == 0xD9) {
+                if (!scanRead) {
+                    fail("ends before the scan");
+                }
+                return;
+            }
+            if ((marker >= 0xD0 && marker <= 0xD7) || marker == 0x01) {
+                continue;
+            }
+
+            if (position + 2 > length) {
+                fail("ends in a segment");
+            }
+            const size_t segmentLength = (data[position] << 8) | data[position + 1];
+            if (segmentLength < 2 || position + segmentLength > length) {
+                fail("ends in a segment");
+            }
+            const uint8_t* payload = data + position + 2;
+            const size_t payloadLength = segmentLength - 2;
+            position += segmentLength;
+
+            if (marker == 0xC0) {
+                readFrame(payload, payloadLength);
+                copySegment(marker, payload, payloadLength);
+            } else if (marker == 0xC4) {
+                readHuffmanTables(payload, payloadLength);
+            } else if (marker == 0xDB) {
+                readQuantisationTables(payload, payloadLength);
+                copySegment(marker, payload, payloadLength);
+            } else if (marker == 0xDD) {
+                if (payloadLength != 2) {
+                    fail("has an invalid restart interval");
+                }
+                jpeg->restartInterval = static_cast<uint16_t>((payload[0] << 8) | payload[1]);
+            } else if (marker == 0xDA) {
+                readScanHeader(payload, payloadLength);
+                decodeScan();
+            } else if ((marker >= 0xE0 && marker <= 0xEF) || marker == 0xFE) {
+                copySegment(marker, payload, payloadLength);
+            } else if (marker >= 0xC1 && marker <= 0xCF) {
+                fail("is not a baseline JPEG, only those can be re-optimised");
+            } else {
+                fail("contains the unsupported marker " + std::to_string(marker));
+            }
+        }
+    }
+
+    void copySegment(const uint8_t marker, const uint8_t* payload, const size_t payloadLength) {
+        jpeg->segments.push_back({ marker, std::vector<uint8_t>(payload, payload + payloadLength) });
+    }
+
+    void readFrame(const uint8_t* payload, const size_t payloadLength) {
+        if (frameRead) {
+            fail("has more than one frame header");
+        }
+        if (payloadLength < 6 || payload[0] != 8) {
+            fail("has an invalid frame header or a sample precision other than 8 bits");
+        }
+        jpeg->height = static_cast<uint16_t>((payload[1] << 8) | payload[2]);
+        jpeg->width = static_cast<uint16_t>((payload[3] << 8) | payload[4]);
+        const unsigned int componentAmount = payload[5];
+        // all components have to fit into the single scan
+        if (jpeg->width == 0 || jpeg->height == 0 || componentAmount == 0 || componentAmount > 4
+            || payloadLength != 6 + 3 * componentAmount) {
+            fail("has an invalid frame header, no size or more than four components");
+        }
+
+        unsigned int maxH = 1, maxV = 1;
+        jpeg->components.resize(componentAmount);
+        for (unsigned int i = 0; i < componentAmount; ++i) {
+            auto& component = jpeg->components[i];
+            component.id = payload[6 + 3 * i];
+            component.H = static_cast<uint8_t>(payload[7 + 3 * i] >> 4);
+            component.V = static_cast<uint8_t>(payload[7 + 3 * i] & 15);
+            component.quantisationTable = payload[8 + 3 * i];
+            if (component.H < 1 || component.H > 4 || component.V < 1 || component.V > 4 || component.quantisationTable > 3) {
+                fail("has invalid sampling factors or quantisation tables");
+            }
+            maxH = std::max<unsigned int>(maxH, component.H);
+            maxV = std::max<unsigned int>(maxV, component.V);
+        }
+
+        // the scan of a single component is not interleaved, its MCUs are single blocks
+        if (componentAmount == 1) {
+            jpeg->components[0].H = jpeg->components[0].V = 1;
+            maxH = maxV = 1;
+        }
+
+        jpeg->mcuRowWidth = (jpeg->width + 8 * maxH - 1) / (8 * maxH);
+        jpeg->mcuRows = (jpeg->height + 8 * maxV - 1) / (8 * maxV);
+        for (auto& component : jpeg->components) {
+            component.blocksWide = ((jpeg->width * component.H + maxH - 1) / maxH + 7) / 8;
+            component.blocksHigh = ((jpeg->height * component.V + maxV - 1) / maxV + 7) / 8;
+        }
+        frameRead = true;
+    }
+
+    void readQuantisationTables(const uint8_t* payload, const size_t payloadLength) {
+        for (size_t i = 0; i < payloadLength;) {
+            const unsigned int precision = payload[i] >> 4, id = payload[i] & 15;
+            const size_t valueBytes = precision == 0 ? 1 : 2;
+            if (precision > 1 || id > 3 || i + 1 + 64 * valueBytes > payloadLength) {
+                fail("has an invalid quantisation table");
+            }
+            // stored in zigzag order, the quantisers use the natural order
+            for (unsigned int k = 0; k < 64; ++k) {
+                const uint8_t* value = payload + i + 1 + k * valueBytes;
+                quantisationTables[id][zigzag.naturalOrder[k]] = precision == 0 ? value[0] : (value[0] << 8) | value[1];
+            }
+            quantisationDefined[id] = true;
+            i += 1 + 64 * valueBytes;
+        }
+    }
+
+    void readHuffmanTables(const uint8_t* payload, const size_t payloadLength) {
+        for (size_t i = 0; i < payloadLength;) {
+            const unsigned int tableClass = payload[i] >> 4, id = payload[i] & 15;
+            if (tableClass > 1 || id > 3 || i + 17 > payloadLength) {
+                fail("has an invalid Huffman table");
+            }
+            const uint8_t* counts = payload + i + 1;
+            unsigned int symbols = 0;
+            for (unsigned int l = 0; l < 16; ++l) {
+                symbols += counts[l];
+            }
+            if (symbols > 256 || i + 17 + symbols > payloadLength) {
+                fail("has an invalid Huffman table");
+            }
+            // the DC symbols are the sizes of the differences, which have at most 11 bits for 8 bit samples
+            for (unsigned int k = 0; tableClass == 0 && k < symbols; ++k) {
+                if (payload[i + 17 + k] > 11) {
+                    fail("has a DC Huffman table with sizes above 11");
+                }
+            }
+
+            HuffmanDecodingTable& table = tableClass == 0 ? dcTables[id] : acTables[id];
+            buildTable(table, counts, payload + i + 17);
+            i += 17 + symbols;
+        }
+    }
+
+    // the canonical codes of Annex C, counts holds the amount of codes of the lengths 1..16
+    void buildTable(HuffmanDecodingTable& table, const uint8_t* counts, const uint8_t* symbols) const {
+        table.lookup.fill(0);
+        int32_t code = 0;
+        unsigned int k = 0;
+        for (unsigned int l = 1; l <= 16; ++l) {
+            table.valueOffset[l] = static_cast<int32_t>(k) - code;
+            // checked before filling the lookup, the codes of an overfull table would lie outside of it
+            if (code + counts[l - 1] > (1 << l)) {
+                fail("has a Huffman table with too many codes");
+            }
+            for (unsigned int i = 0; i < counts[l - 1]; ++i, ++k, ++code) {
+                table.values[k] = symbols[k];
+                if (l <= lookupBits) {
+                    const unsigned int shift = lookupBits - l;
+                    for (unsigned int fill = 0; fill < (1u << shift); ++fill) {
+                        table.lookup[(code << shift) | fill] = static_cast<uint16_t>((l << 8) | symbols[k]);
+                    }
+                }
+            }
+            table.maxCode[l] = counts[l - 1] == 0 ? -1 : code - 1;
+            code <<= 1;
+        }
+        table.defined = true;
+    }
+
+    void readScanHeader(const uint8_t* payload, const size_t payloadLength) {
+        if (!frameRead) {
+            fail("has a scan before the frame header");
+        }
+        if (scanRead) {
+            fail("has more than one scan, only single scan baseline JPEGs can be re-optimised");
+        }
+
+        const unsigned int componentAmount = payloadLength > 0 ? payload[0] : 0;
+        if (componentAmount != jpeg->components.size() || payloadLength != 4 + 2 * componentAmount) {
+            fail("has a scan without all components, only single scan baseline JPEGs can be re-optimised");
+        }
+        const uint8_t* spectral = payload + 1 + 2 * componentAmount;
+        if (spectral[0] != 0 || spectral[1] != 63 || spectral[2] != 0) {
+            fail("has an invalid sequential scan");
+        }
+
+        for (unsigned int i = 0; i < componentAmount; ++i) {
+            auto& component = jpeg->components[i];
+            const unsigned int dcTable = payload[2 + 2 * i] >> 4, acTable = payload[2 + 2 * i] & 15;
+            // the components of an interleaved scan are in the order of the frame
+            if (payload[1 + 2 * i] != component.id || dcTable > 3 || acTable > 3
+                || !dcTables[dcTable].defined || !acTables[acTable].defined) {
+                fail("has a scan with unknown components or Huffman tables");
+            }
+            if (!quantisationDefined[component.quantisationTable]) {
+                fail("has a component without its quantisation table");
+            }
+            scanDcTables.push_back(&dcTables[dcTable]);
+            scanAcTables.push_back(&acTables[acTable]);
+
+            component.quantiser = std::make_unique<Quantiser>(quantisationTables[component.quantisationTable]);
+            const uint32_t blocks = jpeg->mcuRowWidth * jpeg->mcuRows * component.H * component.V;
+            component.channel = std::make_unique<OffsetSampledWriter<T>>(blocks, *component.quantiser);
+            component.channel->countSymbolsOnly();
+        }
+        scanRead = true;
+    }
+
+    void decodeScan() {
+        std::vector<int> previousDc(jpeg->components.size(), 0);
+        const uint32_t mcus = jpeg->mcuRowWidth * jpeg->mcuRows;
+        const uint32_t interval = jpeg->restartInterval;
+
+        for (uint32_t mcu = 0; mcu < mcus; ++mcu) {
+            if (interval != 0 && mcu != 0 && mcu % interval == 0) {
+                readRestartMarker((mcu / interval - 1) & 7);
+                std::fill(previousDc.begin(), previousDc.end(), 0);
+            }
+
+            for (size_t c = 0; c < jpeg->components.size(); ++c) {
+                auto& component = jpeg->components[c];
+                const uint32_t blocksPerMcu = component.H * component.V;
+                for (uint32_t k = 0; k < blocksPerMcu; ++k) {
+                    decodeBlock(*scanDcTables[c], *scanAcTables[c], previousDc[c], *component.channel, mcu * blocksPerMcu + k);
+                }
+            }
+
+            // the padding behind a marker is only there to look ahead
+            if (padding > bits) {
+                fail("ends before the last block of the scan");
+            }
+        }
+
+        skipToMarker();
+    }
+
+    // F.2.2: the DC difference and the run length coded AC coefficients, already in zigzag order
+    inline void decodeBlock(const HuffmanDecodingTable& dc, const HuffmanDecodingTable& ac, int& previousDc,
+                            OffsetSampledWriter<T>& channel, const uint32_t block) {
+        alignas(32) std::array<int16_t, 64> values {};
+
+        previousDc += receiveExtend(decodeSymbol(dc));
+        values[0] = static_cast<int16_t>(previousDc);
+
+        for (unsigned int k = 1; k < 64;) {
+            const uint8_t symbol = decodeSymbol(ac);
+            const unsigned int run = symbol >> 4, size = symbol & 15;
+            if (size == 0) {
+                // EOB, or ZRL for 16 zeros
+                if (run != 15) {
+                    break;
+                }
+                k += 16;
+                continue;
+            }
+
+            k += run;
+            if (k > 63) {
+                fail("has a block with more than 64 coefficients");
+            }
+            values[k++] = static_cast<int16_t>(receiveExtend(size));
+        }
+
+        channel.setCoefficients(values.data(), block);
+    }
+
+    inline uint8_t decodeSymbol(const HuffmanDecodingTable& table) {
+        if (bits < 16) {
+            fillBuffer();
+        }
+        const uint16_t entry = table.lookup[buffer >> (64 - lookupBits)];
+        if (entry != 0) {
+            consume(entry >> 8);
+            return static_cast<uint8_t>(entry);
+        }
+
+        const int32_t code16 = static_cast<int32_t>(buffer >> 48);
+        for (unsigned int l = lookupBits + 1; l <= 16; ++l) {
+            const int32_t code = code16 >> (16 - l);
+            if (code <= table.maxCode[l]) {
+                consume(l);
+                return table.values[code + table.valueOffset[l]];
+            }
+        }
+        fail("contains an invalid Huffman code");
+    }
+
+    // F.2.2.1: size bits of magnitude, a leading 0 marks negative values
+    inline int receiveExtend(const unsigned int size) {
+        if (size == 0) {
+            return 0;
+        }
+        if (bits < static_cast<int>(size)) {
+            fillBuffer();
+        }
+        const int value = static_cast<int>(buffer >> (64 - size));
+        consume(size);
+        return value < (1 << (size - 1)) ? value - (1 << size) + 1 : value;
+    }
+
+    inline void consume(const unsigned int amount) {
+        buffer <<= amount;
+        bits -= static_cast<int>(amount);
+    }
+
+    // reads up to the next marker, the stuffed 0x00 behind a 0xFF is dropped
+    void fillBuffer() {
+        while (bits <= 56) {
+            uint8_t byte = 0;
+            if (!markerReached && position < length) {
+                byte = data[position];
+                if (byte != 0xFF) {
+                    ++position;
+                } else if (position + 1 < length && data[position + 1] == 0x00) {
+                    position += 2;
+                } else {
+                    markerReached = true;
+                }
+            } else {
+                markerReached = true;
+            }
+
+            if (markerReached) {
+                byte = 0;
+                padding += 8;
+            }
+            buffer |= static_cast<uint64_t>(byte) << (56 - bits);
+            bits += 8;
+        }
+    }
+
+    // drops the rest of the entropy coded data, the position is at the following marker afterwards
+    void skipToMarker() {
+        while (position + 1 < length && !(data[position] == 0xFF && data[position + 1] != 0x00 && data[position + 1] != 0xFF)) {
+            ++position;
+        }
+        buffer = 0;
+        bits = 0;
+        padding = 0;
+        markerReached = false;
+    }
+
+    void readRestartMarker(const unsigned int number) {
+        skipToMarker();
+        if (position + 1 >= length || data[position + 1] != 0xD0 + number) {
+            fail("misses a restart marker");
+        }
+        position += 2;
+    }
+};
+
+#endif //MEDIENINFO_JPEGREADER_H
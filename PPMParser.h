@@ -5,6 +5,7 @@
 #include <iostream>
 #include <stdexcept>
 #include <mutex>
+#include <thread>
 
 #include "PixelTypes.h"
 #include "Image.h"
@@ -0,0 +1,312 @@
+#ifndef MEDIENINFO_PROGRESSIVEENCODER_H
+#define MEDIENINFO_PROGRESSIVEENCODER_H
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <immintrin.h>
+#include <memory>
+#include <vector>
+#include "SampledWriter.h"
+#include "ScanScript.h"
+#include "HuffmanEncoder.h"
+#include "helper/MagnitudeCategory.h"
+#include "helper/RunLength.h"
+#include "segments/SOS.h"
+
+/**
+ * Writes the scans of a progressive image (ISO/IEC 10918-1 G.1.2) from the quantised coefficients of the components.
+ * Every scan is coded twice, first only counting the symbols and then with Huffman tables built for exactly that scan
+ * (like the optimised tables of libjpeg). The components select one of two tables, luminance and chrominance.
+ *
+ * The blocks of a component are stored MCU by MCU, H x V blocks each row by row. Scans with a single component visit
+ * its blocks in raster order over the component instead, which skips the padding to whole MCUs. Interleaved scans,
+ * which can only be DC scans, visit the MCUs.
+ */
+template<typename T, typename HT, typename Stream = BitStream>
+class ProgressiveScanWriter {
+private:
+    using HuffmanEncoder = IsoHuffmanEncoder<256, uint8_t, 16>;
+    using Channel = OffsetSampledWriter<T, int16_t>;
+    // the longest run of blocks a single EOBn symbol can end
+    static constexpr uint32_t maxEobRun = 0x7FFF;
+    // correction bits of the AC refinement kept back until the end of the EOB run, as much as libjpeg does
+    static constexpr unsigned int maxCorrectionBits = 1000;
+
+public:
+    struct Component {
+        const Channel* channel;
+        // the id of the frame header and the selected table, 0 or 1
+        uint8_t id, table;
+        // blocks per MCU
+        uint8_t H, V;
+        // size in blocks without the padding to whole MCUs
+        uint32_t blocksWide, blocksHigh;
+    };
+
+    /**
+     * The components of the images of ImageProcessor: Y with 2x2 blocks per MCU, Cb and Cr subsampled to one.
+     */
+    static std::vector<Component> sampledComponents(const Channel& Y, const Channel& Cb, const Channel& Cr,
+                                                    const uint32_t width, const uint32_t height) {
+        const uint32_t chromaWide = (width + 15) / 16, chromaHigh = (height + 15) / 16;
+        return {
+            { &Y, 1, 0, 2, 2, (width + 7) / 8, (height + 7) / 8 },
+            { &Cb, 2, 1, 1, 1, chromaWide, chromaHigh },
+            { &Cr, 3, 1, 1, 1, chromaWide, chromaHigh }
+        };
+    }
+
+private:
+    const std::vector<Component> components;
+    const uint32_t mcuRowWidth, mcuRows;
+
+    // luminance and chrominance symbols of the current scan and the tables built from them
+    std::array<std::array<uint32_t, 256>, 2> histograms;
+    std::array<std::unique_ptr<HuffmanEncoder>, 2> encoders;
+
+    std::vector<int> previousDc;
+    unsigned int table = 0;
+    uint32_t eobRun = 0;
+    // correction bits of the blocks in the EOB run, followed by the ones of the current block
+    std::array<uint8_t, maxCorrectionBits> correctionBits;
+    unsigned int correctionAmount = 0;
+
+public:
+    ProgressiveScanWriter(std::vector<Component> components, const uint32_t mcuRowWidth, const uint32_t mcuRows)
+        : components(std::move(components)), mcuRowWidth(mcuRowWidth), mcuRows(mcuRows),
+          previousDc(this->components.size(), 0) {}
+
+    /**
+     * Writes the DHT segments, the SOS segment and the byte aligned data of the scan.
+     */
+    void writeScan(const ScanScript::Scan& scan, Stream& stream) {
+        // the DC refinement only consists of raw bits
+        const bool huffmanCoded = scan.Ss != 0 || scan.Ah == 0;
+        if (huffmanCoded) {
+            for (auto& histogram : histograms) {
+                histogram.fill(0);
+            }
+            codeScan<true>(scan, stream);
+
+            for (unsigned int t = 0; t < 2; ++t) {
+                encoders[t].reset();
+                if (std::any_of(histograms[t].begin(), histograms[t].end(), [](const uint32_t count) { return count != 0; })) {
+                    HT tree;
+                    tree.sortTree(histograms[t]);
+                    tree.writeSegmentToStream(stream, static_cast<uint8_t>(t), scan.Ss == 0 ? 0 : 1);
+                    encoders[t] = std::make_unique<HuffmanEncoder>(tree.generateEncoder());
+                }
+            }
+        }
+
+        std::vector<uint8_t> ids, tables;
+        for (const uint8_t component : scan.components) {
+            ids.push_back(components[component].id);
+            const uint8_t selector = components[component].table;
+            tables.push_back(static_cast<uint8_t>(scan.Ss == 0 ? selector << 4 : selector));
+        }
+        SOS::write(stream, ids, tables, scan.Ss, scan.Se, scan.Ah, scan.Al);
+
+        codeScan<false>(scan, stream);
+        stream.fillByte();
+    }
+
+private:
+    // index of the block in column x and row y of a component in its channel buffer
+    inline uint32_t blockIndex(const Component& component, const uint32_t x, const uint32_t y) const {
+        const uint32_t mcu = (y / component.V) * mcuRowWidth + x / component.H;
+        return mcu * component.H * component.V + (y % component.V) * component.H + x % component.H;
+    }
+
+    template<bool count>
+    void codeScan(const ScanScript::Scan& scan, Stream& stream) {
+        std::fill(previousDc.begin(), previousDc.end(), 0);
+        eobRun = 0;
+        correctionAmount = 0;
+
+        if (scan.components.size() > 1) {
+            for (uint32_t mcu = 0; mcu < mcuRowWidth * mcuRows; ++mcu) {
+                for (const uint8_t component : scan.components) {
+                    const uint32_t blocksPerMcu = components[component].H * components[component].V;
+                    for (uint32_t k = 0; k < blocksPerMcu; ++k) {
+                        codeDc<count>(scan, component, mcu * blocksPerMcu + k, stream);
+                    }
+                }
+            }
+            return;
+        }
+
+        const unsigned int index = scan.components[0];
+        const Component& component = components[index];
+        table = component.table;
+        for (uint32_t y = 0; y < component.blocksHigh; ++y) {
+            for (uint32_t x = 0; x < component.blocksWide; ++x) {
+                const uint32_t block = blockIndex(component, x, y);
+                if (scan.Ss == 0) {
+                    codeDc<count>(scan, index, block, stream);
+                } else if (scan.Ah == 0) {
+                    codeAcFirst<count>(scan, component.channel->blockCoefficients(block), stream);
+                } else {
+                    codeAcRefinement<count>(scan, component.channel->blockCoefficients(block), stream);
+                }
+            }
+        }
+        emitEobRun<count>(stream);
+    }
+
+    // G.1.2.1: the difference of the DC coefficients shifted by Al, refinements send bit Al itself
+    template<bool count>
+    inline void codeDc(const ScanScript::Scan& scan, const unsigned int component, const uint32_t block, Stream& stream) {
+        const int value = components[component].channel->blockCoefficients(block)[0];
+        if (scan.Ah != 0) {
+            emitBits<count>(stream, static_cast<uint16_t>((value >> scan.Al) & 1), 1);
+            return;
+        }
+
+        const int shifted = value >> scan.Al;
+        const int16_t difference = static_cast<int16_t>(shifted - previousDc[component]);
+        previousDc[component] = shifted;
+
+        const uint8_t size = magnitudeCategory(difference);
+        emitSymbol<count>(stream, components[component].table, size, size, magnitudeBits(difference, size));
+    }
+
+    // G.1.2.2: the magnitudes shifted by Al with runs of empty blocks combined into EOBn symbols
+    template<bool count>
+    inline void codeAcFirst(const ScanScript::Scan& scan, const int16_t* values, Stream& stream) {
+        unsigned int run = 0;
+        for (unsigned int k = scan.Ss; k <= scan.Se; ++k) {
+            const int value = values[k];
+            const int magnitude = (value < 0 ? -value : value) >> scan.Al;
+            if (magnitude == 0) {
+                ++run;
+                continue;
+            }
+
+            emitEobRun<count>(stream);
+            for (; run > 15; run -= 16) {
+                emitSymbol<count>(stream, table, zeroRunSymbol, 0, 0);
+            }
+
+            const uint8_t size = static_cast<uint8_t>(32 - _lzcnt_u32(static_cast<uint32_t>(magnitude)));
+            const int bits = value < 0 ? ~magnitude : magnitude;
+            emitSymbol<count>(stream, table, static_cast<uint8_t>((run << 4) | size), size, static_cast<uint16_t>(bits & ((1 << size) - 1)));
+            run = 0;
+        }
+
+        if (run > 0 && ++eobRun == maxEobRun) {
+            emitEobRun<count>(stream);
+        }
+    }
+
+    /**
+     * G.1.2.3: coefficients that become non zero at bit Al are coded like in the first scan with the size 1, the ones
+     * that already were non zero only send bit Al as a correction bit behind the next symbol.
+     */
+    template<bool count>
+    inline void codeAcRefinement(const ScanScript::Scan& scan, const int16_t* values, Stream& stream) {
+        std::array<int, 64> magnitudes;
+        // the last coefficient that becomes non zero, runs of zeros behind it are left to the EOB
+        unsigned int lastNew = 0;
+        for (unsigned int k = scan.Ss; k <= scan.Se; ++k) {
+            const int value = values[k];
+            magnitudes[k] = (value < 0 ? -value : value) >> scan.Al;
+            if (magnitudes[k] == 1) {
+                lastNew = k;
+            }
+        }
+
+        unsigned int run = 0;
+        // the correction bits of this block start behind the ones of the EOB run
+        unsigned int blockStart = correctionAmount, blockBits = 0;
+        for (unsigned int k = scan.Ss; k <= scan.Se; ++k) {
+            const int magnitude = magnitudes[k];
+            if (magnitude == 0) {
+                ++run;
+                continue;
+            }
+
+            while (run > 15 && k <= lastNew) {
+                emitEobRun<count>(stream);
+                emitSymbol<count>(stream, table, zeroRunSymbol, 0, 0);
+                run -= 16;
+                emitCorrectionBits<count>(stream, blockStart, blockBits);
+                blockStart = 0;
+                blockBits = 0;
+            }
+
+            if (magnitude > 1) {
+                correctionBits[blockStart + blockBits++] = static_cast<uint8_t>(magnitude & 1);
+                continue;
+            }
+
+            emitEobRun<count>(stream);
+            emitSymbol<count>(stream, table, static_cast<uint8_t>((run << 4) | 1), 1, values[k] < 0 ? 0 : 1);
+            emitCorrectionBits<count>(stream, blockStart, blockBits);
+            blockStart = 0;
+            blockBits = 0;
+            run = 0;
+        }
+
+        if (run > 0 || blockBits > 0) {
+            ++eobRun;
+            correctionAmount += blockBits;
+            // the bits of the next block have to fit behind the buffered ones
+            if (eobRun == maxEobRun || correctionAmount > maxCorrectionBits - 63) {
+                emitEobRun<count>(stream);
+            }
+        }
+    }
+
+    template<bool count>
+    inline void emitSymbol(Stream& stream, const unsigned int t, const uint8_t symbol, const uint8_t size, const uint16_t bits) {
+        if (count) {
+            ++histograms[t][symbol];
+        } else {
+            encoders[t]->write(stream, symbol, size, bits);
+        }
+    }
+
+    template<bool count>
+    inline void emitBits(Stream& stream, const uint16_t bits, const uint8_t size) {
+        if (!count) {
+            stream.appendU16(bits, size);
+        }
+    }
+
+    // EOBn ends eobRun blocks, the n extra bits are below the leading one of eobRun
+    template<bool count>
+    inline void emitEobRun(Stream& stream) {
+        if (eobRun == 0) {
+            return;
+        }
+
+        const uint8_t n = static_cast<uint8_t>(31 - _lzcnt_u32(eobRun));
+        if (count) {
+            ++histograms[table][n << 4];
+        } else {
+            // not through the fused table, the size of EOBn is not in the low nibble of the symbol
+            encoders[table]->write(stream, static_cast<uint8_t>(n << 4));
+            if (n != 0) {
+                stream.appendU16(static_cast<uint16_t>(eobRun & ((1u << n) - 1)), n);
+            }
+        }
+        eobRun = 0;
+
+        emitCorrectionBits<count>(stream, 0, correctionAmount);
+        correctionAmount = 0;
+    }
+
+    template<bool count>
+    inline void emitCorrectionBits(Stream& stream, const unsigned int start, const unsigned int amount) {
+        if (count) {
+            return;
+        }
+        for (unsigned int i = start; i < start + amount; ++i) {
+            stream.appendU16(correctionBits[i], 1);
+        }
+    }
+};
+
+#endif //MEDIENINFO_PROGRESSIVEENCODER_H
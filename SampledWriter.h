@@ -1,58 +1,41 @@
 #ifndef MEDIENINFO_SAMPLEDWRITER_H
 #define MEDIENINFO_SAMPLEDWRITER_H
 
+#include <algorithm>
 #include <vector>
 #include <functional>
 #include <cassert>
 #include <cmath>
 #include <iostream>
-#include "quantisation/quantisationTables.h"
+#include <type_traits>
+#include <immintrin.h>
+#include "quantisation/Quantiser.h"
+#include "quantisation/TrellisQuantiser.h"
 #include "HuffmanEncoder.h"
-
-template<typename T, typename Tout = int16_t>
-class Pair {
+#include "helper/MagnitudeCategory.h"
+#include "helper/RunLength.h"
+#include "Image.h"
+
+/**
+ * An entropy coding symbol packed into 32 bits: the Huffman symbol in the lowest byte (the category for DC, run/size
+ * for AC), the amount of extra bits in the second byte and the extra bits in the upper half.
+ */
+class PackedSymbol {
 public:
-    T amount;
-    Tout value;
-    uint16_t bitPattern; // note: The actual amount of used bits is determined by the bit_pattern
-    uint8_t category; // DC: Huffcode this category, then write huff(category) and then bit_pattern (unencoded)
-    uint8_t pairBitwise; // AC: search this value in the huffman tree and write it to the stream, then write bitPattern
-    bool DC;
-
-    void createBitValue() {
-        double log;
-        if (value < 0) {
-            bitPattern = static_cast<uint16_t>(value*-1);
-            bitPattern = ~bitPattern;
-            log = value * -1;
-        } else {
-            bitPattern = static_cast<uint16_t>(value);
-            log = value;
-        }
-        log = std::log2(log);
-        if (log == (int)log) {
-            log++;
-        }
-        this->category = ceil(log);
-        this->bitPattern &= BitStream::ones(this->category);
-        assert(category < 16 && category >= 0);
+    static constexpr uint32_t pack(const uint8_t symbol, const uint8_t size, const uint16_t bits) {
+        return static_cast<uint32_t>(symbol) | (static_cast<uint32_t>(size) << 8) | (static_cast<uint32_t>(bits) << 16);
     }
 
-public:
-    Pair(T first, Tout second) : amount(first), value(second), bitPattern(0), category(0), pairBitwise(0), DC(false) { // AC
-        assert(first < 16);
-        assert(first >= 0);
-
-        createBitValue();
-        assert(static_cast<int>(abs(second)) == static_cast<int>(second < 0 ? (~bitPattern & BitStream::ones(category)) : bitPattern));
+    static constexpr uint8_t symbol(const uint32_t packed) {
+        return static_cast<uint8_t>(packed);
+    }
 
-        pairBitwise = amount;
-        pairBitwise = pairBitwise << 4;
-        pairBitwise |= category & 0x0F;
+    static constexpr uint8_t size(const uint32_t packed) {
+        return static_cast<uint8_t>(packed >> 8);
     }
 
-    Pair(Tout nr) : amount(0), value(nr), bitPattern(0), category(0), pairBitwise(0), DC(true) { // DC
-        createBitValue();
+    static constexpr uint16_t bits(const uint32_t packed) {
+        return static_cast<uint16_t>(packed >> 16);
     }
 };
 
@@ -104,8 +87,19 @@ private:
 
 public:
     std::array<std::array<uint, 8>, 8> acLookupTable {0};
+    // natural index (v * 8 + u) for every zigzag position, position 0 is the DC coefficient
+    std::array<uint8_t, 64> naturalOrder {0};
+
     constexpr ZikZakLookupTable() {
         genAcLookupTable(acLookupTable);
+
+        for (uint u = 0; u < 8; ++u) {
+            for (uint v = 0; v < 8; ++v) {
+                if (u != 0 || v != 0) {
+                    naturalOrder[acLookupTable[u][v] + 1] = static_cast<uint8_t>((v << 3) + u);
+                }
+            }
+        }
     }
 
 };
@@ -116,125 +110,237 @@ class OffsetSampledWriter {
 private:
     using uint = unsigned int;
 
-    const uint rowwidth = 8;
-    const uint blocksize = rowwidth * rowwidth;
-    const uint acBlockSize = blocksize - 1;
-    const uint size;
+    using coefficientTile = typename Block<T>::rowBlock;
+    using shortVec16 = Vc::fixed_size_simd<int16_t, 16>;
+
+    static constexpr uint blocksize = 64;
+    // guess for the reserved symbols, the vector still grows for highly detailed images
+    static constexpr uint expectedSymbolsPerBlock = 24;
+    static constexpr ZikZakLookupTable zigzag {};
+    const uint blocks;
+    // blocks between two restart markers, the DC prediction starts at 0 again after each of them
+    uint restartBlocks = 0;
+    // false when only the histograms are counted and the scan is written from the coefficients
+    bool keepSymbols = true;
+
+    std::array<uint16_t, blocksize> categories, extraBits;
 
-    std::vector<Tout> output_dc;
-    std::vector<Tout> output_ac;
+    // blocksize values per block: the DC coefficient followed by the 63 AC coefficients in zigzag order
+    std::vector<Tout> coefficients;
+    // the unquantised coefficients in the same order, only kept for the trellis quantisation
+    std::vector<float> rawCoefficients;
 
 public:
-    std::vector<Pair<uint8_t,Tout>> runLengthEncoded;
+    // one bit per zigzag position for every block, set when the quantised coefficient is not zero
+    std::vector<uint64_t> nonZeroMasks;
+    // the run length encoded blocks as PackedSymbols, every block starts with its DC symbol
+    std::vector<uint32_t> symbols;
+    // index of the first symbol of every block, the last entry is the end of the last encoded block
+    std::vector<uint32_t> blockStarts;
     std::array<uint32_t, 256> huffweight_ac = {0}, huffweight_dc = {0};
 
 private:
-    const ZikZakLookupTable acLookupTableGen;
-    const std::array<std::array<uint, 8>, 8>& acLookupTable = acLookupTableGen.acLookupTable;
-    const QuantisationTable& qTable;
+    const Quantiser& quantiser;
 
 public:
-    explicit OffsetSampledWriter(const uint blocks, const QuantisationTable& qTable)
-        : size(blocks * blocksize), qTable(qTable) {
-        // resize, but substract one for each block because the first coefficient is AC
-        output_ac.resize(size - blocks, 0);
-        output_dc.resize(blocks, 0);
+    explicit OffsetSampledWriter(const uint blocks, const Quantiser& quantiser)
+        : blocks(blocks), quantiser(quantiser) {
+        coefficients.resize(blocks * blocksize, 0);
+        nonZeroMasks.resize(blocks, 0);
+        symbols.reserve(blocks * expectedSymbolsPerBlock);
+        blockStarts.resize(blocks + 1, 0);
     }
 
-    void set(const T& val, const uint block, const uint x, const uint y) {
-        const auto divisor =  qTable[(x << 3) + y];
-        const auto extra = val < 0 ? -(divisor >> 1) : (divisor >> 1);
-        const Tout valm = static_cast<Tout>((val + extra) / divisor);
-        assert(abs(static_cast<T>(val)/divisor) < 32767);
-
-        if(x == 0 && y == 0) {
-#ifdef NDEBUG
-            output_dc[block] = valm;
-#else
-            output_dc.at(block) = valm;
-#endif
+    /**
+     * Quantises a whole tile of coefficients (rows are the vertical frequencies like the blocks, [v][u]) and stores
+     * it in zigzag order. Returns the non zero mask of the block.
+     */
+    uint64_t setTile(const coefficientTile& tile, const uint block) {
+        static_assert(std::is_same<Tout, int16_t>::value, "the tiles are stored as 16 bit coefficients");
+        assert(block < blocks);
+
+        alignas(32) std::array<Tout, blocksize> natural;
+        for (uint v = 0; v < 8; ++v) {
+            Vc::simd_cast<Vc::fixed_size_simd<Tout, 8>>(quantiser.quantiseRow(tile[v], v)).store(&natural[v << 3], Vc::Aligned);
         }
-        else {
-#ifdef NDEBUG
-            output_ac[(block * acBlockSize) + acLookupTable[x][y]] = valm;
-#else
 
-            output_ac.at((block * acBlockSize) + acLookupTable[x][y]) = valm;
-#endif
+        Tout* out = &coefficients[block * blocksize];
+        for (uint i = 0; i < blocksize; ++i) {
+            out[i] = natural[zigzag.naturalOrder[i]];
+        }
+
+        if (!rawCoefficients.empty()) {
+            alignas(32) std::array<float, blocksize> raw;
+            for (uint v = 0; v < 8; ++v) {
+                Vc::simd_cast<Vc::fixed_size_simd<float, 8>>(tile[v]).store(&raw[v << 3], Vc::Aligned);
+            }
+            float* rawOut = &rawCoefficients[block * blocksize];
+            for (uint i = 0; i < blocksize; ++i) {
+                rawOut[i] = raw[zigzag.naturalOrder[i]];
+            }
         }
+
+        return updateNonZeroMask(block);
+    }
+
+    /**
+     * Stores already quantised coefficients of a block (DC first, AC in zigzag order), e.g. decoded from a JPEG.
+     * Returns the non zero mask of the block.
+     */
+    uint64_t setCoefficients(const Tout* values, const uint block) {
+        assert(block < blocks);
+        std::copy(values, values + blocksize, &coefficients[block * blocksize]);
+        return updateNonZeroMask(block);
+    }
+
+    /**
+     * Keeps the unquantised coefficients of the following tiles, which is needed for trellisQuantisation.
+     */
+    void keepRawCoefficients() {
+        rawCoefficients.resize(blocks * blocksize, 0);
+    }
+
+    /**
+     * Requantises the AC coefficients of all blocks rate-distortion optimised with the symbol costs of the given
+     * statistics and redoes the run length encoding.
+     */
+    void trellisQuantisation(const std::array<uint32_t, 256> histogram, const float lambdaScale = TrellisQuantiser::defaultLambdaScale) {
+        assert(!rawCoefficients.empty());
+        const TrellisQuantiser trellis(quantiser.table, zigzag.naturalOrder, histogram, lambdaScale);
+
+        for (uint block = 0; block < blocks; ++block) {
+            trellis.quantiseBlock(&rawCoefficients[block * blocksize], &coefficients[block * blocksize]);
+            updateNonZeroMask(block);
+        }
+
+        clearRunLengthEncoding();
+        runLengthEncoding();
+    }
+
+    /**
+     * Drops the symbols and histograms, so the blocks can be run length encoded again.
+     */
+    void clearRunLengthEncoding() {
+        symbols.clear();
+        huffweight_ac.fill(0);
+        huffweight_dc.fill(0);
     }
 
     void runLengthEncoding() {
-        partialRunLengthEncoding(0, output_dc.size());
+        partialRunLengthEncoding(0, blocks);
     }
 
-    void partialRunLengthEncoding(const int start, int stop) {
-        Tout prev_dc = (start == 0) ? 0 : output_dc[start - 1];
-        int dc_offset = start;
-
-        stop *= 63;
-        for(int b = (start * 63); b < stop; b += 63) {
-
-            Tout cur_dc = output_dc[dc_offset++];
-            auto p = Pair<uint8_t, Tout>(cur_dc - prev_dc);
-            ++huffweight_dc[p.category];
-            this->runLengthEncoded.emplace_back(p);
-            prev_dc = cur_dc;
-
-            uint amountZeros = 0;
-            for(int k = b; k < b+63; ++k) {
-                const auto value = output_ac[k];
-                if (value != 0) {
-                    while(amountZeros > 15) {
-                        Pair<uint8_t, Tout> temp(15,0);
-                        ++huffweight_ac[temp.pairBitwise];
-                        this->runLengthEncoded.emplace_back(temp);
-                        amountZeros -= 16;
-                    }
-                    Pair<uint8_t, Tout> temp(amountZeros,value);
-                    ++huffweight_ac[temp.pairBitwise];
-                    runLengthEncoded.emplace_back(temp);
-                    amountZeros = 0;
-                } else {
-                    amountZeros++;
-                }
+    /**
+     * Only counts the symbol statistics in the following run length encodings, the symbols are not stored. The scan
+     * then has to be written with CoefficientStreamWriter.
+     */
+    void countSymbolsOnly() {
+        keepSymbols = false;
+        std::vector<uint32_t>().swap(symbols);
+        std::vector<uint32_t>().swap(blockStarts);
+    }
+
+    /**
+     * The quantised coefficients of a block, DC first and the AC coefficients in zigzag order.
+     */
+    inline const Tout* blockCoefficients(const uint block) const {
+        return &coefficients[block * blocksize];
+    }
+
+    /**
+     * Resets the DC prediction every amount blocks (0 never resets), has to be set before the run length encoding.
+     */
+    void setRestartInterval(const uint amount) {
+        restartBlocks = amount;
+    }
+
+private:
+    template<bool store>
+    inline void addAcSymbol(const uint8_t symbol, const uint8_t size, const uint16_t bits) {
+        ++huffweight_ac[symbol];
+        if (store) {
+            symbols.push_back(PackedSymbol::pack(symbol, size, bits));
+        }
+    }
+
+    uint64_t updateNonZeroMask(const uint block) {
+        const Tout* values = &coefficients[block * blocksize];
+        uint64_t mask = 0;
+        for (uint i = 0; i < blocksize; i += shortVec16::size()) {
+            const shortVec16 v(values + i, Vc::Unaligned);
+            mask |= static_cast<uint64_t>(static_cast<uint16_t>((v != 0).toInt())) << i;
+        }
+
+        nonZeroMasks[block] = mask;
+        return mask;
+    }
+
+    template<bool store>
+    void encodeBlocks(const int start, const int stop) {
+        Tout prev_dc = (start == 0) ? 0 : coefficients[(start - 1) * blocksize];
+
+        for(int block = start; block < stop; ++block) {
+            const Tout* values = &coefficients[block * blocksize];
+            if (store) {
+                blockStarts[block] = static_cast<uint32_t>(symbols.size());
             }
 
-            if (amountZeros != 0) {
-                Pair<uint8_t, Tout> temp(0, 0);
-                ++huffweight_ac[temp.pairBitwise];
-                runLengthEncoded.emplace_back(temp);
+            if (restartBlocks != 0 && block % restartBlocks == 0) {
+                prev_dc = 0;
             }
+
+            runLengthEncodeBlock<store>(values, prev_dc, nonZeroMasks[block], categories, extraBits,
+                [this](const uint8_t size, const uint16_t bits) {
+                    ++huffweight_dc[size];
+                    if (store) {
+                        symbols.push_back(PackedSymbol::pack(size, size, bits));
+                    }
+                },
+                [this](const uint8_t symbol, const uint8_t size, const uint16_t bits) {
+                    addAcSymbol<store>(symbol, size, bits);
+                });
+            prev_dc = values[0];
+        }
+
+        if (store) {
+            blockStarts[stop] = static_cast<uint32_t>(symbols.size());
+        }
+    }
+
+public:
+
+    /**
+     * Counts the symbols of the blocks start..stop-1 into the histograms and stores them unless countSymbolsOnly was
+     * called.
+     */
+    void partialRunLengthEncoding(const int start, const int stop) {
+        if (keepSymbols) {
+            encodeBlocks<true>(start, stop);
+        } else {
+            encodeBlocks<false>(start, stop);
         }
     }
 };
 
-template<typename T>
+template<typename T, typename Stream = BitStream>
 class StreamWriter {
 private:
     using HuffmanEncoder = IsoHuffmanEncoder<256, uint8_t, 16>;
-    const OffsetSampledWriter<T, int16_t> channel;
+    const OffsetSampledWriter<T, int16_t>& channel;
     const HuffmanEncoder& ac_encoder, dc_encoder;
     const uint32_t rowWidth;
-    uint32_t offset = 0;
-    BitStream& stream;
+    uint32_t block = 0;
+    Stream& stream;
 
 public:
     StreamWriter(const OffsetSampledWriter<T, int16_t> &channel, const HuffmanEncoder &ac_encoder,
-                 const HuffmanEncoder &dc_encoder, BitStream& bs, const uint32_t rowWidth) :
+                 const HuffmanEncoder &dc_encoder, Stream& bs, const uint32_t rowWidth) :
                  channel(channel), ac_encoder(ac_encoder), dc_encoder(dc_encoder), rowWidth(rowWidth), stream(bs) {
 
     }
 
     void skip(uint32_t amount) {
-        while(amount > 0) {
-#ifdef NDEBUG
-            while(!channel.runLengthEncoded[++offset].DC);
-#else
-            while(!channel.runLengthEncoded.at(++offset).DC);
-#endif
-            --amount;
-        }
+        block += amount;
     }
 
     void skipRow() {
@@ -242,34 +348,64 @@ public:
     }
 
     void writeBlock() {
-        assert(channel.runLengthEncoded.at(offset).DC);
-        writeDcPair(channel.runLengthEncoded[offset]);
-
-        while(offset < (channel.runLengthEncoded.size() - 1)) {
-            const auto& p =
-#ifdef NDEBUG
-                    channel.runLengthEncoded[++offset];
-#else
-                    channel.runLengthEncoded.at(++offset);
-#endif
-            if(p.DC)
-                break;
-            writeAcPair(p);
+        const uint32_t start = channel.blockStarts[block], end = channel.blockStarts[block + 1];
+        assert(start < end && end <= channel.symbols.size());
+
+        writeSymbol(dc_encoder, channel.symbols[start]);
+        for (uint32_t i = start + 1; i < end; ++i) {
+            writeSymbol(ac_encoder, channel.symbols[i]);
         }
+        ++block;
+    }
+
+private:
+    inline void writeSymbol(const HuffmanEncoder& encoder, const uint32_t symbol) {
+        encoder.write(stream, PackedSymbol::symbol(symbol), PackedSymbol::size(symbol), PackedSymbol::bits(symbol));
+    }
+};
+
+/**
+ * Entropy codes blocks straight from the quantised coefficients and non zero masks of a channel, without the symbols of
+ * the run length encoding. The DC prediction is kept here, so the blocks have to be written in order.
+ */
+template<typename T, typename Stream = BitStream>
+class CoefficientStreamWriter {
+private:
+    using HuffmanEncoder = IsoHuffmanEncoder<256, uint8_t, 16>;
+
+    const OffsetSampledWriter<T, int16_t>* channel;
+    const HuffmanEncoder& ac_encoder, dc_encoder;
+    Stream& stream;
+    int16_t previousDc = 0;
+    std::array<uint16_t, 64> categories, extraBits;
+
+public:
+    CoefficientStreamWriter(const OffsetSampledWriter<T, int16_t> &channel, const HuffmanEncoder &ac_encoder,
+                            const HuffmanEncoder &dc_encoder, Stream& bs) :
+                            channel(&channel), ac_encoder(ac_encoder), dc_encoder(dc_encoder), stream(bs) {
+
+    }
+
+    // continues with the blocks of another channel buffer, the DC prediction carries over
+    void setChannel(const OffsetSampledWriter<T, int16_t>& next) {
+        channel = &next;
     }
 
-    template<typename T1>
-    inline void writeAcPair(const Pair<T1, int16_t>& p) {
-        ac_encoder.write(stream, p.pairBitwise);
-        if (p.category != 0)
-            stream.appendU16(p.bitPattern, p.category);
+    // the DC prediction starts at 0 after a restart marker
+    void resetPrediction() {
+        previousDc = 0;
     }
 
-    template<typename T1>
-    inline void writeDcPair(const Pair<T1, int16_t>& p) {
-        dc_encoder.write(stream, p.category);
-        if (p.category != 0)
-            stream.appendU16(p.bitPattern, p.category);
+    void writeBlock(const uint32_t block) {
+        const int16_t* values = channel->blockCoefficients(block);
+        runLengthEncodeBlock<true>(values, previousDc, channel->nonZeroMasks[block], categories, extraBits,
+            [this](const uint8_t size, const uint16_t bits) {
+                dc_encoder.write(stream, size, size, bits);
+            },
+            [this](const uint8_t symbol, const uint8_t size, const uint16_t bits) {
+                ac_encoder.write(stream, symbol, size, bits);
+            });
+        previousDc = values[0];
     }
 };
 
@@ -0,0 +1,204 @@
+#ifndef MEDIENINFO_SCANSCRIPT_H
+#define MEDIENINFO_SCANSCRIPT_H
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/**
+ * The scans of a progressive image (ISO/IEC 10918-1 G.1). Every scan codes the band Ss..Se of the zigzag ordered
+ * coefficients of its components at the bit position Al; Ah is the Al of the previous scan of the band, 0 for the first
+ * one. Scripts are stored as text like the scan files of jpegtran:
+ *
+ *   <components separated by commas>: <Ss>-<Se>, <Ah>, <Al>;
+ *
+ * with the components 0 = Y, 1 = Cb and 2 = Cr. Text after # is ignored up to the end of the line.
+ */
+struct ScanScript {
+    static constexpr unsigned int componentAmount = 3;
+
+    struct Scan {
+        std::vector<uint8_t> components;
+        uint8_t Ss = 0, Se = 63, Ah = 0, Al = 0;
+    };
+
+    std::vector<Scan> scans;
+
+    /**
+     * The script of jpeg_simple_progression: the DC first, a few luminance AC coefficients early and the last bit of
+     * every band at the end. Other amounts of components (up to the four of a scan) get its script for any colour
+     * space.
+     */
+    static ScanScript standard(const unsigned int components = componentAmount) {
+        ScanScript script;
+        if (components == componentAmount) {
+            script.scans = {
+                { { 0, 1, 2 }, 0, 0, 0, 1 },
+                { { 0 }, 1, 5, 0, 2 },
+                { { 2 }, 1, 63, 0, 1 },
+                { { 1 }, 1, 63, 0, 1 },
+                { { 0 }, 6, 63, 0, 2 },
+                { { 0 }, 1, 63, 2, 1 },
+                { { 0, 1, 2 }, 0, 0, 1, 0 },
+                { { 2 }, 1, 63, 1, 0 },
+                { { 1 }, 1, 63, 1, 0 },
+                { { 0 }, 1, 63, 1, 0 }
+            };
+            return script;
+        }
+
+        std::vector<uint8_t> all;
+        for (unsigned int component = 0; component < components; ++component) {
+            all.push_back(static_cast<uint8_t>(component));
+        }
+        const auto addBand = [&script, components](const uint8_t Ss, const uint8_t Se, const uint8_t Ah, const uint8_t Al) {
+            for (unsigned int component = 0; component < components; ++component) {
+                script.scans.push_back({ { static_cast<uint8_t>(component) }, Ss, Se, Ah, Al });
+            }
+        };
+
+        script.scans.push_back({ all, 0, 0, 0, 1 });
+        addBand(1, 5, 0, 2);
+        addBand(6, 63, 0, 2);
+        addBand(1, 63, 2, 1);
+        script.scans.push_back({ all, 0, 0, 1, 0 });
+        addBand(1, 63, 1, 0);
+        return script;
+    }
+
+    static ScanScript load(const std::string& path) {
+        std::ifstream file(path);
+        if (!file) {
+            throw std::runtime_error("Can not read the scan script " + path);
+        }
+
+        std::string text, line;
+        while (std::getline(file, line)) {
+            text += line.substr(0, line.find('#')) + "\n";
+        }
+
+        ScanScript script;
+        std::istringstream entries(text);
+        std::string entry;
+        while (std::getline(entries, entry, ';')) {
+            if (entry.find_first_not_of(" \t\r\n") == std::string::npos) {
+                continue;
+            }
+            script.scans.push_back(parseScan(entry, path));
+        }
+
+        script.validate(path);
+        return script;
+    }
+
+    /**
+     * Checks the rules of G.1.1.1: DC and AC coefficients are never mixed, AC scans have a single component, every
+     * refinement continues the bit position of the previous scan of the same coefficients and in the end every
+     * coefficient of the given amount of components is sent down to bit 0.
+     */
+    void validate(const std::string& name, const unsigned int components = componentAmount) const {
+        // the Al every coefficient was last sent with, -1 before the first scan
+        std::vector<std::array<int, 64>> sentTo(components);
+        for (auto& component : sentTo) {
+            component.fill(-1);
+        }
+
+        if (scans.empty()) {
+            fail(name, "has no scans");
+        }
+        for (const Scan& scan : scans) {
+            if (scan.components.empty() || scan.components.size() > std::min(components, 4u)) {
+                fail(name, "has a scan without or with too many components");
+            }
+            if (scan.Ss > scan.Se || scan.Se > 63 || (scan.Ss == 0 && scan.Se != 0)) {
+                fail(name, "has a scan mixing DC and AC coefficients or an invalid band");
+            }
+            if (scan.Ss != 0 && scan.components.size() != 1) {
+                fail(name, "has an AC scan with more than one component");
+            }
+            if (scan.Al > 13 || (scan.Ah != 0 && scan.Ah != scan.Al + 1)) {
+                fail(name, "has a scan with an invalid successive approximation");
+            }
+
+            for (unsigned int i = 0; i < scan.components.size(); ++i) {
+                const uint8_t component = scan.components[i];
+                if (component >= components || (i > 0 && component <= scan.components[i - 1])) {
+                    fail(name, "has a scan with unknown or unordered components");
+                }
+
+                for (unsigned int k = scan.Ss; k <= scan.Se; ++k) {
+                    int& sent = sentTo[component][k];
+                    const bool first = scan.Ah == 0;
+                    if ((first && sent != -1) || (!first && sent != scan.Ah)) {
+                        fail(name, "refines coefficients that were not sent down to Ah or sends them twice");
+                    }
+                    // the AC coefficients can only be sent after the DC coefficient
+                    if (k != 0 && first && sentTo[component][0] == -1) {
+                        fail(name, "sends AC coefficients before the DC coefficient");
+                    }
+                    sent = scan.Al;
+                }
+            }
+        }
+
+        for (const auto& component : sentTo) {
+            for (const int sent : component) {
+                if (sent != 0) {
+                    fail(name, "does not send every coefficient completely");
+                }
+            }
+        }
+    }
+
+private:
+    static Scan parseScan(const std::string& entry, const std::string& path) {
+        const size_t colon = entry.find(':');
+        if (colon == std::string::npos) {
+            fail(path, "has a scan without the component list");
+        }
+
+        Scan scan;
+        std::istringstream components(entry.substr(0, colon));
+        std::string component;
+        while (std::getline(components, component, ',')) {
+            scan.components.push_back(static_cast<uint8_t>(parseNumber(component, path)));
+        }
+
+        std::istringstream parameters(entry.substr(colon + 1));
+        std::string band, ah, al;
+        if (!std::getline(parameters, band, ',') || !std::getline(parameters, ah, ',') || !std::getline(parameters, al)) {
+            fail(path, "has a scan without Ss-Se, Ah, Al");
+        }
+        const size_t dash = band.find('-');
+        if (dash == std::string::npos) {
+            fail(path, "has a scan without the band Ss-Se");
+        }
+
+        scan.Ss = static_cast<uint8_t>(parseNumber(band.substr(0, dash), path));
+        scan.Se = static_cast<uint8_t>(parseNumber(band.substr(dash + 1), path));
+        scan.Ah = static_cast<uint8_t>(parseNumber(ah, path));
+        scan.Al = static_cast<uint8_t>(parseNumber(al, path));
+        return scan;
+    }
+
+    static unsigned int parseNumber(const std::string& text, const std::string& path) {
+        std::istringstream stream(text);
+        int value;
+        std::string rest;
+        if (!(stream >> value) || (stream >> rest) || value < 0 || value > 63) {
+            fail(path, "has an invalid number '" + text + "'");
+        }
+        return static_cast<unsigned int>(value);
+    }
+
+    [[noreturn]] static void fail(const std::string& name, const std::string& reason) {
+        throw std::runtime_error("The scan script " + name + " " + reason);
+    }
+};
+
+#endif //MEDIENINFO_SCANSCRIPT_H
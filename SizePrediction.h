@@ -0,0 +1,83 @@
+#ifndef MEDIENINFO_SIZEPREDICTION_H
+#define MEDIENINFO_SIZEPREDICTION_H
+
+#include <array>
+#include <cassert>
+#include <cstdint>
+#include "segments/DHT.h"
+
+/**
+ * Size of an encoded image computed from the symbol histograms and the Huffman tables. The Huffman codes and extra
+ * bits of the scan follow exactly from the histograms, as every run/size symbol fixes the amount of extra bits. The
+ * padding before every restart marker and the 0x00 stuffed behind every 0xFF byte depend on the bit positions, so
+ * they are given as bounds.
+ */
+class EncodedSizePrediction {
+public:
+    // all markers and segments except the scan data and the restart markers
+    uint64_t headerBytes = 0;
+    // Huffman codes and extra bits of the scan
+    uint64_t scanBits = 0;
+    // byte aligned parts of the scan, one per restart interval
+    uint64_t intervals = 1;
+    // the RSTn markers between the intervals
+    uint64_t markerBytes = 0;
+
+    /**
+     * Adds the DHT segment of the table and the codes of the histogram to the scan. bits[0] is unused like in
+     * HuffmanTree, huffval is a std::vector or std::array.
+     */
+    template<typename Values>
+    void addTable(const std::array<uint8_t, 17>& bits, const Values& huffval, const std::array<uint32_t, 256>& histogram, const bool ac) {
+        const auto lengths = codeLengths(bits, huffval);
+
+        uint32_t amount = 0;
+        for (unsigned int length = 1; length < bits.size(); ++length) {
+            amount += bits[length];
+        }
+        headerBytes += sizeof(DHT) + 1 + 16 + amount;
+
+        for (unsigned int symbol = 0; symbol < histogram.size(); ++symbol) {
+            if (histogram[symbol] == 0) {
+                continue;
+            }
+            assert(lengths[symbol] != 0);
+            const unsigned int extraBits = ac ? symbol & 0x0F : symbol;
+            scanBits += static_cast<uint64_t>(histogram[symbol]) * (lengths[symbol] + extraBits);
+        }
+    }
+
+    // padded scan bytes without any stuffing, exact without restart markers
+    uint64_t minimumScanBytes() const {
+        return (scanBits + 7) / 8;
+    }
+
+    // every interval padded by up to 7 bits
+    uint64_t maximumScanBytes() const {
+        return (scanBits + 7 * intervals) / 8;
+    }
+
+    // no byte of the scan is 0xFF
+    uint64_t minimumBytes() const {
+        return headerBytes + minimumScanBytes() + markerBytes;
+    }
+
+    // every byte of the scan is 0xFF and needs a stuffed 0x00
+    uint64_t maximumBytes() const {
+        return headerBytes + 2 * maximumScanBytes() + markerBytes;
+    }
+
+    template<typename Values>
+    static std::array<uint8_t, 256> codeLengths(const std::array<uint8_t, 17>& bits, const Values& huffval) {
+        std::array<uint8_t, 256> lengths = {0};
+        unsigned int k = 0;
+        for (unsigned int length = 1; length < bits.size(); ++length) {
+            for (unsigned int j = 0; j < bits[length]; ++j) {
+                lengths[huffval[k++]] = static_cast<uint8_t>(length);
+            }
+        }
+        return lengths;
+    }
+};
+
+#endif //MEDIENINFO_SIZEPREDICTION_H
@@ -1,4 +1,6 @@
 #include <benchmark/benchmark.h>
+#include <random>
+#include <vector>
 #include "../BitStream.h"
 #include "../segments/APP0.h"
 #include "../segments/SOF0.h"
@@ -63,6 +65,39 @@ static void BM_Defined10KKWrite(benchmark::State& state) {
 }
 
 
+/*
+ * Huffman code + extra bits pairs like the entropy coder writes them: 2..16 bit codes followed by 0..10 extra bits,
+ * with random bits so some of the written bytes are 0xFF and need to be stuffed.
+ */
+template<typename Stream>
+static void BM_SymbolWrite(benchmark::State& state) {
+    std::mt19937 generator(42);
+    std::uniform_int_distribution<int> codeLength(2, 16);
+    std::uniform_int_distribution<int> extraLength(0, 10);
+    std::uniform_int_distribution<int> bits(0, 0xFFFF);
+
+    std::vector<std::array<uint16_t, 4>> symbols(1 << 20);
+    for (auto& symbol : symbols) {
+        symbol = { static_cast<uint16_t>(bits(generator)), static_cast<uint16_t>(codeLength(generator)),
+                   static_cast<uint16_t>(bits(generator)), static_cast<uint16_t>(extraLength(generator)) };
+    }
+
+    for (auto _ : state) {
+        Stream bs("/tmp/test4.bin", 1600, 1600);
+
+        for (const auto& symbol : symbols) {
+            bs.appendU16(symbol[0], symbol[1]);
+            if (symbol[3] != 0) {
+                bs.appendU16(symbol[2], symbol[3]);
+            }
+        }
+        bs.fillByte();
+        benchmark::ClobberMemory();
+    }
+
+    state.SetItemsProcessed(state.iterations() * symbols.size());
+}
+
 //BENCHMARK_TEMPLATE(BM_BasicBitAppending, BitStreamSeb);
 //BENCHMARK_TEMPLATE(BM_BasicBitAppending, BitStreamDeinzer);
 //BENCHMARK_TEMPLATE(BM_SegmentWrite, BitStreamSeb);
@@ -71,3 +106,9 @@ static void BM_Defined10KKWrite(benchmark::State& state) {
 //BENCHMARK_TEMPLATE(BM_Random10KKWrite, BitStreamDeinzer);
 //BENCHMARK_TEMPLATE(BM_Defined10KKWrite, BitStreamSeb);
 //BENCHMARK_TEMPLATE(BM_Defined10KKWrite, BitStreamDeinzer);
+BENCHMARK_TEMPLATE(BM_Random10KKWrite, BitStreamSeb);
+BENCHMARK_TEMPLATE(BM_Random10KKWrite, BitStreamDeinzer);
+BENCHMARK_TEMPLATE(BM_Random10KKWrite, BitStreamAccumulator);
+BENCHMARK_TEMPLATE(BM_SymbolWrite, BitStreamSeb);
+BENCHMARK_TEMPLATE(BM_SymbolWrite, BitStreamDeinzer);
+BENCHMARK_TEMPLATE(BM_SymbolWrite, BitStreamAccumulator);
@@ -5,6 +5,7 @@
 #include "../dct/DirectCosinusTransform.h"
 #include "../dct/SeparatedCosinusTransform.h"
 #include "../dct/AraiSimdSimple.h"
+#include "../dct/LoefflerSimd.h"
 
 template<typename Transform, typename T = float>
 static void TestConversionDeinzer(benchmark::State& state) {
@@ -84,19 +85,27 @@ static void TestConversionSmall(benchmark::State& state) {
 //BENCHMARK_TEMPLATE(TestConversionDeinzer, AraiSimdSimple<float>);
 //BENCHMARK_TEMPLATE(TestConversionDeinzer, AraiSimdSimple<int32_t>, int32_t);
 //BENCHMARK_TEMPLATE(TestConversionDeinzer, AraiSimdSimple<short>, short);
+//BENCHMARK_TEMPLATE(TestConversionDeinzer, LoefflerSimd<float>);
+//BENCHMARK_TEMPLATE(TestConversionDeinzer, LoefflerSimd<int32_t>);
 //BENCHMARK_TEMPLATE(TestConversionBlockwiseAraiFloatThreaded, 2);
 //BENCHMARK_TEMPLATE(TestConversionBlockwiseAraiFloatThreaded, 4);
 //BENCHMARK_TEMPLATE(TestConversionBlockwiseAraiFloatThreaded, 8);
 BENCHMARK_TEMPLATE(TestConversionBlockwiseAraiFloatThreaded, 16);
 BENCHMARK_TEMPLATE(TestConversionBlockwiseAraiFloatThreaded, 16, SeparatedCosinusTransform<float>);
 BENCHMARK_TEMPLATE(TestConversionBlockwiseAraiFloatThreaded, 16, DirectCosinusTransform<float>);
+BENCHMARK_TEMPLATE(TestConversionBlockwiseAraiFloatThreaded, 16, LoefflerSimd<float>);
+BENCHMARK_TEMPLATE(TestConversionBlockwiseAraiFloatThreaded, 16, LoefflerSimd<int32_t>);
 
 BENCHMARK_TEMPLATE(TestConversionBlockwiseAraiFloat, DirectCosinusTransform<float>);
 BENCHMARK_TEMPLATE(TestConversionBlockwiseAraiFloat, SeparatedCosinusTransform<float>);
 BENCHMARK_TEMPLATE(TestConversionBlockwiseAraiFloat, AraiSimdSimple<float>);
+BENCHMARK_TEMPLATE(TestConversionBlockwiseAraiFloat, LoefflerSimd<float>);
+BENCHMARK_TEMPLATE(TestConversionBlockwiseAraiFloat, LoefflerSimd<int32_t>);
 
 BENCHMARK_TEMPLATE(TestConversionSmall, DirectCosinusTransform<float>);
 BENCHMARK_TEMPLATE(TestConversionSmall, SeparatedCosinusTransform<float>);
 BENCHMARK_TEMPLATE(TestConversionSmall, AraiSimdSimple<float>);
+BENCHMARK_TEMPLATE(TestConversionSmall, LoefflerSimd<float>);
+BENCHMARK_TEMPLATE(TestConversionSmall, LoefflerSimd<int32_t>);
 //BENCHMARK_TEMPLATE(TestConversionSmall, AraiSimdSimple<int32_t>, int32_t);
 //BENCHMARK_TEMPLATE(TestConversionSmall, AraiSimdSimple<short>, short);
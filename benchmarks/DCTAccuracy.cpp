@@ -0,0 +1,246 @@
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <random>
+#include "../PPMParser.h"
+#include "../Image.h"
+#include "../quantisation/quantisationTables.h"
+#include "../dct/DirectCosinusTransform.h"
+#include "../dct/SeparatedCosinusTransform.h"
+#include "../dct/AraiSimdSimple.h"
+#include "../dct/LoefflerSimd.h"
+
+/*
+ * Accuracy next to throughput for every transform. Each transform runs over four sets of level shifted 8x8 blocks:
+ *  0 random:   uniform noise, the worst case for the rounding errors
+ *  1 gradient: linear ramps in all directions
+ *  2 edge:     hard steps in all directions and positions
+ *  3 photo:    the luminance blocks of the PPM given by the DCT_ACCURACY_PPM environment variable
+ *
+ * Counters: blocks per second, max/mean absolute coefficient error against a double precision DCT, the PSNR after
+ * quantising with luminaceOnePlus5 and an exact inverse DCT, and the same PSNR for the double precision DCT.
+ * Use --benchmark_filter=DCTAccuracy --benchmark_format=json (or --benchmark_out=file.json) to get the results as JSON.
+ */
+
+// [y][x] for pixels, [u][v] (horizontal, vertical frequency) for coefficients
+using DoubleBlock = std::array<std::array<double, 8>, 8>;
+
+static const char* const accuracyBlockSetNames[] = { "random", "gradient", "edge", "photo" };
+
+static std::vector<DoubleBlock> generateRandomBlocks() {
+    std::mt19937 generator(42);
+    std::uniform_int_distribution<int> distribution(-128, 127);
+
+    std::vector<DoubleBlock> blocks(1024);
+    for (auto& block : blocks) {
+        for (auto& row : block) {
+            for (auto& pixel : row) {
+                pixel = distribution(generator);
+            }
+        }
+    }
+    return blocks;
+}
+
+static std::vector<DoubleBlock> generateGradientBlocks() {
+    std::vector<DoubleBlock> blocks;
+    for (int dx = -32; dx <= 32; dx += 4) {
+        for (int dy = -32; dy <= 32; dy += 4) {
+            for (const int offset : { -96, 0, 96 }) {
+                DoubleBlock block;
+                for (int y = 0; y < 8; ++y) {
+                    for (int x = 0; x < 8; ++x) {
+                        const int value = offset + dx * (2 * x - 7) / 2 + dy * (2 * y - 7) / 2;
+                        block[y][x] = std::clamp(value, -128, 127);
+                    }
+                }
+                blocks.push_back(block);
+            }
+        }
+    }
+    return blocks;
+}
+
+static std::vector<DoubleBlock> generateEdgeBlocks() {
+    std::vector<DoubleBlock> blocks;
+    // vertical, horizontal and both diagonal edges
+    for (int direction = 0; direction < 4; ++direction) {
+        for (int position = 1; position < 8; ++position) {
+            for (const int low : { -128, -64, 0 }) {
+                for (const int high : { 32, 127 }) {
+                    DoubleBlock block;
+                    for (int y = 0; y < 8; ++y) {
+                        for (int x = 0; x < 8; ++x) {
+                            const int d = direction == 0 ? x : direction == 1 ? y : direction == 2 ? (x + y) / 2 : (x + 7 - y) / 2;
+                            block[y][x] = d < position ? low : high;
+                        }
+                    }
+                    blocks.push_back(block);
+                }
+            }
+        }
+    }
+    return blocks;
+}
+
+static std::vector<DoubleBlock> loadPhotoBlocks() {
+    std::vector<DoubleBlock> blocks;
+    const char* path = std::getenv("DCT_ACCURACY_PPM");
+    if (path == nullptr) {
+        return blocks;
+    }
+
+    std::shared_ptr<BlockwiseRawImage> image;
+    {
+        // the destructor waits for the reader thread
+        PPMParser<BlockwiseRawImage> parser(1, 1);
+        image = parser.parsePPM(path);
+    }
+
+    // at most 4096 blocks, evenly distributed over the image
+    const size_t step = std::max<size_t>(1, image->blocks.size() / 1024);
+    for (size_t i = 0; i < image->blocks.size(); i += step) {
+        for (const auto& yRow : image->blocks[i].Y) {
+            for (const auto& y : yRow) {
+                DoubleBlock block;
+                for (uint row = 0; row < 8; ++row) {
+                    for (uint col = 0; col < 8; ++col) {
+                        block[row][col] = std::round(static_cast<float>(y[row][col]));
+                    }
+                }
+                blocks.push_back(block);
+            }
+        }
+    }
+    return blocks;
+}
+
+static std::vector<DoubleBlock> generateAccuracyBlocks(const int set) {
+    switch (set) {
+        case 0: return generateRandomBlocks();
+        case 1: return generateGradientBlocks();
+        case 2: return generateEdgeBlocks();
+        default: return loadPhotoBlocks();
+    }
+}
+
+static const std::array<std::array<double, 8>, 8> referenceMatrix = generateDctMatrix<double, 8>();
+
+static DoubleBlock referenceDct(const DoubleBlock& pixels) {
+    DoubleBlock result;
+    for (uint u = 0; u < 8; ++u) {
+        for (uint v = 0; v < 8; ++v) {
+            double sum = 0;
+            for (uint y = 0; y < 8; ++y) {
+                for (uint x = 0; x < 8; ++x) {
+                    sum += referenceMatrix[u][x] * referenceMatrix[v][y] * pixels[y][x];
+                }
+            }
+            result[u][v] = sum;
+        }
+    }
+    return result;
+}
+
+/**
+ * Quantises like OffsetSampledWriter, dequantises and transforms back. Returns the squared error over the block
+ * after rounding and clamping the reconstructed pixels like a decoder would.
+ */
+static double quantisedSquaredError(const DoubleBlock& pixels, const DoubleBlock& coefficients) {
+    DoubleBlock dequantised;
+    for (uint u = 0; u < 8; ++u) {
+        for (uint v = 0; v < 8; ++v) {
+            const int divisor = luminaceOnePlus5[(v << 3) + u];
+            const double value = coefficients[u][v];
+            const double extra = value < 0 ? -(divisor >> 1) : (divisor >> 1);
+            dequantised[u][v] = std::trunc((value + extra) / divisor) * divisor;
+        }
+    }
+
+    double error = 0;
+    for (uint y = 0; y < 8; ++y) {
+        for (uint x = 0; x < 8; ++x) {
+            double sum = 0;
+            for (uint u = 0; u < 8; ++u) {
+                for (uint v = 0; v < 8; ++v) {
+                    sum += referenceMatrix[u][x] * referenceMatrix[v][y] * dequantised[u][v];
+                }
+            }
+            const double diff = std::clamp(std::round(sum), -128., 127.) - pixels[y][x];
+            error += diff * diff;
+        }
+    }
+    return error;
+}
+
+static double psnr(const double squaredError, const size_t pixelCount) {
+    const double mse = squaredError / pixelCount;
+    return mse == 0 ? 99. : 10 * std::log10(255. * 255. / mse);
+}
+
+template<typename Transform, typename T = float>
+static void DCTAccuracy(benchmark::State& state) {
+    using rowBlock = std::array<Vc::fixed_size_simd<T, 8>, 8>;
+
+    const auto pixels = generateAccuracyBlocks(state.range(0));
+    state.SetLabel(accuracyBlockSetNames[state.range(0)]);
+    if (pixels.empty()) {
+        state.SkipWithError("set DCT_ACCURACY_PPM to a ppm image for the photo blocks");
+        return;
+    }
+
+    std::vector<rowBlock> input(pixels.size());
+    for (size_t i = 0; i < pixels.size(); ++i) {
+        for (uint y = 0; y < 8; ++y) {
+            for (uint x = 0; x < 8; ++x) {
+                input[i][y][x] = static_cast<T>(pixels[i][y][x]);
+            }
+        }
+    }
+
+    std::vector<DoubleBlock> output(pixels.size());
+    DoubleBlock* current = nullptr;
+    const std::function<void (const uint8_t, const uint8_t, const T)> set = [&current](const uint8_t u, const uint8_t v, const T c) {
+        (*current)[u][v] = c;
+    };
+
+    Transform transform;
+    for (auto _ : state) {
+        for (size_t i = 0; i < input.size(); ++i) {
+            // some transforms work in place
+            rowBlock block = input[i];
+            current = &output[i];
+            transform.template transformBlock<uint8_t>(block, set);
+        }
+        benchmark::ClobberMemory();
+    }
+
+    double maxError = 0, errorSum = 0, squaredError = 0, referenceSquaredError = 0;
+    for (size_t i = 0; i < pixels.size(); ++i) {
+        const DoubleBlock reference = referenceDct(pixels[i]);
+        for (uint u = 0; u < 8; ++u) {
+            for (uint v = 0; v < 8; ++v) {
+                const double error = std::abs(output[i][u][v] - reference[u][v]);
+                maxError = std::max(maxError, error);
+                errorSum += error;
+            }
+        }
+        squaredError += quantisedSquaredError(pixels[i], output[i]);
+        referenceSquaredError += quantisedSquaredError(pixels[i], reference);
+    }
+
+    state.counters["blocks_per_second"] = benchmark::Counter(state.iterations() * pixels.size(), benchmark::Counter::kIsRate);
+    state.counters["max_error"] = maxError;
+    state.counters["mean_error"] = errorSum / (pixels.size() * 64);
+    state.counters["psnr"] = psnr(squaredError, pixels.size() * 64);
+    state.counters["psnr_reference"] = psnr(referenceSquaredError, pixels.size() * 64);
+}
+
+BENCHMARK_TEMPLATE(DCTAccuracy, DirectCosinusTransform<float>)->DenseRange(0, 3)->ArgName("blocks");
+BENCHMARK_TEMPLATE(DCTAccuracy, SeparatedCosinusTransform<float>)->DenseRange(0, 3)->ArgName("blocks");
+BENCHMARK_TEMPLATE(DCTAccuracy, AraiSimdSimple<float>)->DenseRange(0, 3)->ArgName("blocks");
+BENCHMARK_TEMPLATE(DCTAccuracy, AraiSimdSimple<short>, short)->DenseRange(0, 3)->ArgName("blocks");
+BENCHMARK_TEMPLATE(DCTAccuracy, LoefflerSimd<float>)->DenseRange(0, 3)->ArgName("blocks");
+BENCHMARK_TEMPLATE(DCTAccuracy, LoefflerSimd<int32_t>)->DenseRange(0, 3)->ArgName("blocks");
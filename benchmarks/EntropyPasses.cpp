@@ -0,0 +1,155 @@
+#include <benchmark/benchmark.h>
+
+#include "ScanFixture.h"
+#include "../dct/SeparatedCosinusTransform.h"
+
+/*
+ * The two entropy coding passes of the optimised tables: the run length encoding that gathers the statistics and the
+ * sequential scan with the final tables. With the argument 0 the first pass stores every symbol and the scan replays
+ * them, with 1 the first pass only counts and the scan is coded from the quantised coefficients.
+ */
+static void BM_EntropyPasses(benchmark::State& state) {
+    using Processor = ImageProcessor<float, SeparatedCosinusTransform<float>>;
+
+    Processor processor;
+    processor.coefficientScan = state.range(0) != 0;
+
+    // the tables stay the same for every iteration
+    ScanFixture fixture(processor.coefficientScan);
+    auto& Y = fixture.Y;
+    auto& Cb = fixture.Cb;
+    auto& Cr = fixture.Cr;
+    const auto tables = fixture.encoders();
+
+    ParallelFor<1> parallel;
+    uint64_t bytes = 0;
+
+    for (auto _ : state) {
+        Y.clearRunLengthEncoding();
+        Cb.clearRunLengthEncoding();
+        Cr.clearRunLengthEncoding();
+        Y.runLengthEncoding();
+        Cb.runLengthEncoding();
+        Cr.runLengthEncoding();
+
+        BitStream bs("/tmp/test-passes.bin", ScanFixture::mcus * 16, 16);
+        processor.writeScan(parallel, Y, Cb, Cr, tables.y_ac, tables.y_dc, tables.c_ac, tables.c_dc,
+                            ScanFixture::mcuRowWidth, ScanFixture::mcus, bs);
+        bytes = bs.length();
+    }
+
+    state.SetItemsProcessed(state.iterations() * ScanFixture::mcus);
+    state.counters["scan_bytes"] = bytes;
+    state.counters["symbol_buffer_bytes"] = (Y.symbols.capacity() + Cb.symbols.capacity() + Cr.symbols.capacity()) * sizeof(uint32_t);
+}
+
+BENCHMARK(BM_EntropyPasses)->Arg(0)->Arg(1)->ArgName("coefficient_scan");
+
+/*
+ * Codes the scan of the same coefficients with the Huffman tables built for them (argument 0) or with the adaptive
+ * arithmetic coder (argument 1), scan_bytes compares the compression.
+ */
+static void BM_ArithmeticScan(benchmark::State& state) {
+    const bool arithmetic = state.range(0) != 0;
+
+    ScanFixture fixture(true);
+    const auto tables = fixture.encoders();
+    uint64_t bytes = 0;
+
+    for (auto _ : state) {
+        BitStream bs("/tmp/test-arithmetic.bin", ScanFixture::mcus * 16, 16);
+
+        if (arithmetic) {
+            QmEncoder<BitStream> coder(bs);
+            ArithmeticStatistics luminanceStatistics, chrominanceStatistics;
+            ArithmeticBlockWriter<float, BitStream> wy(fixture.Y, coder, luminanceStatistics);
+            ArithmeticBlockWriter<float, BitStream> wcb(fixture.Cb, coder, chrominanceStatistics);
+            ArithmeticBlockWriter<float, BitStream> wcr(fixture.Cr, coder, chrominanceStatistics);
+            ScanFixture::writeMcus(wy, wcb, wcr);
+            coder.finish();
+        } else {
+            CoefficientStreamWriter<float, BitStream> wy(fixture.Y, tables.y_ac, tables.y_dc, bs);
+            CoefficientStreamWriter<float, BitStream> wcb(fixture.Cb, tables.c_ac, tables.c_dc, bs);
+            CoefficientStreamWriter<float, BitStream> wcr(fixture.Cr, tables.c_ac, tables.c_dc, bs);
+            ScanFixture::writeMcus(wy, wcb, wcr);
+            bs.fillByte();
+        }
+        bytes = bs.length();
+    }
+
+    state.SetItemsProcessed(state.iterations() * ScanFixture::mcus);
+    state.counters["scan_bytes"] = bytes;
+}
+
+BENCHMARK(BM_ArithmeticScan)->Arg(0)->Arg(1)->ArgName("arithmetic");
+
+/*
+ * The scans of the standard progressive script (ScanScript::standard) over the same coefficients, every scan counts its
+ * symbols and is coded with its own tables. Compare scan_bytes with BM_EntropyPasses.
+ */
+static void BM_ProgressiveScans(benchmark::State& state) {
+    using Writer = ProgressiveScanWriter<float, ScanFixture::HT, BitStream>;
+
+    const ScanFixture fixture(true);
+    const ScanScript script = ScanScript::standard();
+    uint64_t bytes = 0;
+
+    for (auto _ : state) {
+        BitStream bs("/tmp/test-progressive.bin", ScanFixture::mcus * 16, 16);
+        Writer writer(Writer::sampledComponents(fixture.Y, fixture.Cb, fixture.Cr, ScanFixture::width, ScanFixture::height),
+                      ScanFixture::mcuRowWidth, ScanFixture::mcus / ScanFixture::mcuRowWidth);
+        for (const auto& scan : script.scans) {
+            writer.writeScan(scan, bs);
+        }
+        bytes = bs.length();
+    }
+
+    state.SetItemsProcessed(state.iterations() * ScanFixture::mcus);
+    state.counters["scan_bytes"] = bytes;
+}
+
+BENCHMARK(BM_ProgressiveScans);
+
+/*
+ * Re-optimises a baseline JPEG of the same coefficients written with the Annex K tables: the entropy decoding to the
+ * coefficients and the new scan with optimised tables (argument 0) or the standard progressive script (argument 1).
+ * Compare the time with BM_EntropyPasses and output_bytes with input_bytes.
+ */
+static void BM_ReoptimiseJpeg(benchmark::State& state) {
+    using Processor = ImageProcessor<float, SeparatedCosinusTransform<float>>;
+
+    Processor processor;
+    const ScanFixture fixture(true);
+
+    BitStream input("/tmp/test-reoptimise.jpg", ScanFixture::width, ScanFixture::height);
+    processor.writeMetadataHeaders(ScanFixture::width, ScanFixture::height, input);
+    DHT::write<16>(input, 2, 1, annexKLuminanceAc.bits, annexKLuminanceAc.huffval);
+    DHT::write<16>(input, 0, 0, annexKLuminanceDc.bits, annexKLuminanceDc.huffval);
+    DHT::write<16>(input, 3, 1, annexKChrominanceAc.bits, annexKChrominanceAc.huffval);
+    DHT::write<16>(input, 1, 0, annexKChrominanceDc.bits, annexKChrominanceDc.huffval);
+    SOS sos;
+    _write_segment_ref(input, sos);
+    ParallelFor<1> parallel;
+    processor.coefficientScan = true;
+    processor.writeScan(parallel, fixture.Y, fixture.Cb, fixture.Cr, annexKLuminanceAcEncoder, annexKLuminanceDcEncoder,
+                        annexKChrominanceAcEncoder, annexKChrominanceDcEncoder, ScanFixture::mcuRowWidth, ScanFixture::mcus, input);
+    processor.writeEOI(input);
+
+    if (state.range(0) != 0) {
+        processor.scanScript = std::make_shared<const ScanScript>(ScanScript::standard());
+    }
+    uint64_t bytes = 0;
+
+    for (auto _ : state) {
+        const auto jpeg = BaselineJpegReader<float>::read(input.data(), input.length(), "benchmark");
+        BitStream output("/tmp/test-reoptimised.jpg", ScanFixture::width, ScanFixture::height);
+        processor.reoptimiseImage(*jpeg, output);
+        bytes = output.length();
+    }
+
+    state.SetItemsProcessed(state.iterations() * ScanFixture::mcus);
+    state.counters["input_bytes"] = input.length();
+    state.counters["output_bytes"] = bytes;
+}
+
+BENCHMARK(BM_ReoptimiseJpeg)->Arg(0)->Arg(1)->ArgName("progressive");
@@ -6,6 +6,8 @@
 #include "../HuffmenTreeSorts/HuffmanTreeIsoSort.h"
 #include "../HuffmenTreeSorts/HuffmanTreeSimpleSort.h"
 #include "../HuffmenTreeSorts/HuffmanTreeSort.h"
+#include "../HuffmenTreeSorts/HuffmanTreeMoffat.h"
+#include "../HuffmenTreeSorts/HuffmanTreePackageMerge.h"
 
 static void BM_WriteDhtSegment(benchmark::State& state) {
     APP0 app0;
@@ -95,9 +97,43 @@ static void BM_HuffmantreeRandom(benchmark::State& state) {
     }
 }
 
+// bits of all symbols coded with the lengths of the tree
+template<typename Tree>
+static double codedBits(const Tree& tree, const std::array<uint32_t, 256>& values) {
+    double sum = 0;
+    uint32_t k = 0;
+    for (uint32_t length = 1; length < tree.bits.size(); ++length) {
+        for (uint32_t j = 0; j < tree.bits[length]; ++j) {
+            sum += static_cast<double>(values[tree.huffval[k++]]) * length;
+        }
+    }
+    return sum;
+}
+
+/*
+ * A geometric distribution needs codes far longer than 16 bits without a limit, so it shows how much the length
+ * limiting costs: the coded_bits counter is the size of the symbols with the resulting code lengths.
+ */
+template<typename Tree>
+static void BM_HuffmantreeSkewed(benchmark::State& state) {
+    std::array<uint32_t, 256> values;
+    for (uint32_t i = 0; i < values.size(); i++) {
+        values[i] = i < 120 ? (1u << 30) >> (i / 4) : 1;
+    }
+
+    Tree tree;
+    for (auto _ : state) {
+        tree.sortTree(values);
+    }
+
+    state.counters["coded_bits"] = codedBits(tree, values);
+}
+
 typedef HuffmanTreeSimpleSort<256, uint8_t, uint32_t, uint16_t> HtSimple;
 typedef HuffmanTreeSort<256, uint8_t, uint32_t, uint16_t> HtNormal;
 typedef HuffmanTreeIsoSort<256, uint8_t, uint32_t, uint16_t> HtIso;
+typedef HuffmanTreeMoffat<256, uint8_t, uint32_t, uint16_t> HtMoffat;
+typedef HuffmanTreePackageMerge<256, uint8_t, uint32_t, uint16_t> HtPackageMerge;
 
 //BENCHMARK(BM_WriteDhtSegment);
 //BENCHMARK(BM_WriteDhtSegmentIso);
@@ -107,3 +143,10 @@ typedef HuffmanTreeIsoSort<256, uint8_t, uint32_t, uint16_t> HtIso;
 //BENCHMARK_TEMPLATE(BM_HuffmantreeRandom, HtSimple);
 //BENCHMARK_TEMPLATE(BM_HuffmantreeRandom, HtNormal);
 //BENCHMARK_TEMPLATE(BM_HuffmantreeRandom, HtIso);
+BENCHMARK_TEMPLATE(BM_HuffmantreeRandom, HtNormal);
+BENCHMARK_TEMPLATE(BM_HuffmantreeRandom, HtIso);
+BENCHMARK_TEMPLATE(BM_HuffmantreeRandom, HtMoffat);
+BENCHMARK_TEMPLATE(BM_HuffmantreeRandom, HtPackageMerge);
+BENCHMARK_TEMPLATE(BM_HuffmantreeSkewed, HtIso);
+BENCHMARK_TEMPLATE(BM_HuffmantreeSkewed, HtMoffat);
+BENCHMARK_TEMPLATE(BM_HuffmantreeSkewed, HtPackageMerge);
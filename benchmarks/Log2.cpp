@@ -1,6 +1,8 @@
 #include <stdint.h>
 #include <benchmark/benchmark.h>
 #include <cmath>
+#include <random>
+#include "../helper/MagnitudeCategory.h"
 
 const int runs = 100000;
 const int initial_global = 249;
@@ -67,3 +69,58 @@ static void Log2TestCounting(benchmark::State& state) {
 //BENCHMARK(Log2TestBuiltin);
 //BENCHMARK(Log2TestCounting);
 //BENCHMARK(Log2TestStd);
+
+// JPEG size categories of a block of coefficients, like the run length encoding needs them
+
+static std::array<int16_t, 64> generateCategoryBlock() {
+    std::mt19937 generator(42);
+    std::uniform_int_distribution<int> distribution(-300, 300);
+    std::array<int16_t, 64> block;
+    for (auto& v : block) {
+        v = static_cast<int16_t>(distribution(generator));
+    }
+    return block;
+}
+
+// the former Pair::createBitValue
+static inline uint8_t category_log2(const int16_t value) {
+    double log = std::log2(value < 0 ? -value : value);
+    if (log == (int)log) {
+        log++;
+    }
+    return static_cast<uint8_t>(ceil(log));
+}
+
+static void CategoryLog2(benchmark::State& state) {
+    const auto block = generateCategoryBlock();
+    for (auto _ : state) {
+        for (const auto v : block) {
+            benchmark::DoNotOptimize(category_log2(v));
+        }
+    }
+}
+
+static void CategoryLzcnt(benchmark::State& state) {
+    const auto block = generateCategoryBlock();
+    for (auto _ : state) {
+        for (const auto v : block) {
+            const uint8_t category = magnitudeCategory(v);
+            benchmark::DoNotOptimize(category);
+            benchmark::DoNotOptimize(magnitudeBits(v, category));
+        }
+    }
+}
+
+static void CategoryTile(benchmark::State& state) {
+    const auto block = generateCategoryBlock();
+    std::array<uint16_t, 64> categories, bits;
+    for (auto _ : state) {
+        magnitudeCategories(block.data(), categories, bits);
+        benchmark::DoNotOptimize(categories);
+        benchmark::DoNotOptimize(bits);
+    }
+}
+
+BENCHMARK(CategoryLog2);
+BENCHMARK(CategoryLzcnt);
+BENCHMARK(CategoryTile);
@@ -0,0 +1,47 @@
+#include <benchmark/benchmark.h>
+
+#include <random>
+#include "../EncodingProcessor.h"
+#include "../dct/SeparatedCosinusTransform.h"
+
+/*
+ * The single pass encoding with the Annex K tables of a synthetic 1920x1080 image, with the argument 1 the entropy
+ * coding runs on its own thread behind the transform (pipelinedScan), with 0 both stages alternate on one thread.
+ * The image is smooth noise, so the blocks are neither empty nor full.
+ */
+
+static std::unique_ptr<BlockwiseRawImage> generatePipelineImage() {
+    auto image = std::make_unique<BlockwiseRawImage>(1920, 1080, 255);
+    std::mt19937 generator(42);
+    std::normal_distribution<float> noise(0.f, 6.f);
+
+    for (int block = 0; block < image->blockAmount; ++block) {
+        const int bx = block % image->blockRowWidth, by = block / image->blockRowWidth;
+        for (int y = 0; y < 16; ++y) {
+            for (int x = 0; x < 16; ++x) {
+                const float wave = 64.f * std::sin((bx * 16 + x) * 0.02f) * std::cos((by * 16 + y) * 0.03f);
+                image->blocks[block].setPixel(x, y, wave + noise(generator), noise(generator), noise(generator));
+            }
+        }
+    }
+    image->blockRowsProcessed = image->blockHeight;
+    return image;
+}
+
+static void BM_PipelinedScan(benchmark::State& state) {
+    const auto image = generatePipelineImage();
+    ImageProcessor<float, SeparatedCosinusTransform<float>> processor;
+    processor.pipelinedScan = state.range(0) != 0;
+    uint64_t bytes = 0;
+
+    for (auto _ : state) {
+        BitStream bs("/tmp/test-pipeline.jpg", image->width, image->height);
+        processor.processImageSinglePass(*image, bs);
+        bytes = bs.length();
+    }
+
+    state.SetItemsProcessed(state.iterations() * image->blockAmount);
+    state.counters["bytes"] = bytes;
+}
+
+BENCHMARK(BM_PipelinedScan)->Arg(0)->Arg(1)->ArgName("pipelined")->UseRealTime()->Unit(benchmark::kMillisecond);
@@ -0,0 +1,38 @@
+#include <benchmark/benchmark.h>
+
+#include "ScanFixture.h"
+#include "../dct/SeparatedCosinusTransform.h"
+
+/*
+ * Entropy coding of the scan with restart intervals for 1, 2, 4 and 8 worker threads. The argument is the restart
+ * interval in MCUs, 0 is the sequential scan without markers.
+ */
+
+template<int threads>
+static void BM_RestartIntervalScan(benchmark::State& state) {
+    using Processor = ImageProcessor<float, SeparatedCosinusTransform<float>>;
+
+    Processor processor;
+    processor.restartInterval = static_cast<unsigned int>(state.range(0));
+
+    ScanFixture fixture(false, processor.restartInterval);
+    const auto tables = fixture.encoders();
+
+    ParallelFor<threads> parallel;
+    uint64_t bytes = 0;
+
+    for (auto _ : state) {
+        BitStream bs("/tmp/test-rst.bin", ScanFixture::mcus * 16, 16);
+        processor.writeScan(parallel, fixture.Y, fixture.Cb, fixture.Cr, tables.y_ac, tables.y_dc, tables.c_ac,
+                            tables.c_dc, ScanFixture::mcuRowWidth, ScanFixture::mcus, bs);
+        bytes = bs.length();
+    }
+
+    state.SetItemsProcessed(state.iterations() * ScanFixture::mcus);
+    state.counters["scan_bytes"] = bytes;
+}
+
+BENCHMARK_TEMPLATE(BM_RestartIntervalScan, 1)->Arg(0)->Arg(16)->Arg(128)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_RestartIntervalScan, 2)->Arg(16)->Arg(128)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_RestartIntervalScan, 4)->Arg(16)->Arg(128)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_RestartIntervalScan, 8)->Arg(16)->Arg(128)->UseRealTime();
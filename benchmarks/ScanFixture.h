@@ -0,0 +1,94 @@
+#ifndef MEDIENINFO_SCANFIXTURE_H
+#define MEDIENINFO_SCANFIXTURE_H
+
+#include <random>
+#include "../EncodingProcessor.h"
+
+/*
+ * The quantised and run length encoded channels of a 1920x1088 image (120x68 = 8160 MCUs) with the default quantisation
+ * tables and the Huffman trees built for them, shared by the scan benchmarks. The coefficients are random with the
+ * amplitude falling off towards the high frequencies like in a photo.
+ */
+struct ScanFixture {
+    using HT = HuffmanTreeIsoSort<256, uint8_t, uint32_t, uint8_t, 16>;
+    using HuffmanEncoder = IsoHuffmanEncoder<256, uint8_t, 16>;
+
+    static constexpr uint32_t width = 1920, height = 1088;
+    static constexpr uint32_t mcuRowWidth = width / 16, mcus = mcuRowWidth * (height / 16);
+
+    struct Encoders {
+        HuffmanEncoder y_ac, y_dc, c_ac, c_dc;
+    };
+
+    const Quantiser luminance, chrominance;
+    OffsetSampledWriter<float> Y, Cb, Cr;
+    HT y_ac, y_dc, c_ac, c_dc;
+
+    /**
+     * @param countSymbolsOnly the run length encoding only counts, the scan has to be coded from the coefficients
+     * @param restartInterval MCUs between two restart markers, 0 writes none
+     */
+    explicit ScanFixture(const bool countSymbolsOnly = false, const unsigned int restartInterval = 0)
+        : luminance(luminaceOnePlus5), chrominance(chrominaceOnePlus5),
+          Y(mcus * 4, luminance), Cb(mcus, chrominance), Cr(mcus, chrominance) {
+        for (OffsetSampledWriter<float>* channel : { &Y, &Cb, &Cr }) {
+            if (countSymbolsOnly) {
+                channel->countSymbolsOnly();
+            }
+            channel->setRestartInterval(restartInterval * (channel == &Y ? 4 : 1));
+        }
+
+        std::mt19937 generator(42);
+        fillTiles(Y, mcus * 4, generator);
+        fillTiles(Cb, mcus, generator);
+        fillTiles(Cr, mcus, generator);
+        Y.runLengthEncoding();
+        Cb.runLengthEncoding();
+        Cr.runLengthEncoding();
+
+        y_ac.sortTree(Y.huffweight_ac);
+        y_dc.sortTree(Y.huffweight_dc);
+        c_ac.sortTreeSummed(Cb.huffweight_ac, Cr.huffweight_ac);
+        c_dc.sortTreeSummed(Cb.huffweight_dc, Cr.huffweight_dc);
+    }
+
+    ScanFixture(const ScanFixture&) = delete;
+    ScanFixture& operator=(const ScanFixture&) = delete;
+
+    Encoders encoders() {
+        return { y_ac.generateEncoder(), y_dc.generateEncoder(), c_ac.generateEncoder(), c_dc.generateEncoder() };
+    }
+
+    /**
+     * Writes all MCUs in order, four luminance blocks followed by the two chrominance blocks, with writers that take
+     * the index of the block.
+     */
+    template<typename BlockWriter>
+    static void writeMcus(BlockWriter& y, BlockWriter& cb, BlockWriter& cr) {
+        for (uint32_t mcu = 0; mcu < mcus; ++mcu) {
+            y.writeBlock(mcu * 4);
+            y.writeBlock(mcu * 4 + 1);
+            y.writeBlock(mcu * 4 + 2);
+            y.writeBlock(mcu * 4 + 3);
+            cb.writeBlock(mcu);
+            cr.writeBlock(mcu);
+        }
+    }
+
+private:
+    static void fillTiles(OffsetSampledWriter<float>& channel, const uint32_t blocks, std::mt19937& generator) {
+        std::normal_distribution<float> distribution(0.f, 1.f);
+        Block<float>::rowBlock tile;
+
+        for (uint32_t block = 0; block < blocks; ++block) {
+            for (unsigned int v = 0; v < 8; ++v) {
+                for (unsigned int u = 0; u < 8; ++u) {
+                    tile[v][u] = distribution(generator) * 600.f / (1 + 2 * (u + v));
+                }
+            }
+            channel.setTile(tile, block);
+        }
+    }
+};
+
+#endif //MEDIENINFO_SCANFIXTURE_H
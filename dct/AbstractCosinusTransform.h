@@ -2,11 +2,64 @@
 #define MEDIENINFO_DISCRETECOSINUSTRANSFORM_H
 
 #include <vector>
+#include <array>
 #include <functional>
 #include "../Image.h"
 
 using uint = unsigned int;
 
+constexpr double constexprPi = 3.141592653589793238462643383279502884;
+
+/**
+ * Cosine that can be evaluated at compile time (std::cos is not constexpr). The argument is reduced to [-pi, pi] and
+ * the taylor series is summed until the terms vanish, which is exact to double precision for that range.
+ */
+constexpr double constexprCos(double x) {
+    while (x > constexprPi)
+        x -= 2 * constexprPi;
+    while (x < -constexprPi)
+        x += 2 * constexprPi;
+
+    const double x2 = x * x;
+    double term = 1, sum = 1;
+    for (int n = 2; n < 60; n += 2) {
+        term *= -x2 / (n * (n - 1));
+        sum += term;
+    }
+    return sum;
+}
+
+/**
+ * Square root that can be evaluated at compile time, using newton iterations.
+ */
+constexpr double constexprSqrt(const double x) {
+    double r = x > 1 ? x : 1;
+    for (int i = 0; i < 100; ++i)
+        r = 0.5 * (r + x / r);
+    return r;
+}
+
+/**
+ * The orthonormal DCT-II matrix A (A(k, n) = C(k) * sqrt(2/N) * cos((2n + 1) * k * pi / 2N)) or its transpose.
+ */
+template<typename T, unsigned int N>
+constexpr std::array<std::array<T, N>, N> generateDctMatrix(const bool transposed = false) {
+    std::array<std::array<T, N>, N> A {};
+    const double prefix = constexprSqrt(2. / N);
+
+    for (uint k = 0; k < N; ++k) {
+        const double c = k == 0 ? prefix / constexprSqrt(2.) : prefix;
+        for (uint n = 0; n < N; ++n) {
+            const double value = c * constexprCos(((n << 1) + 1) * k * constexprPi / (2 * N));
+            if (transposed)
+                A[n][k] = static_cast<T>(value);
+            else
+                A[k][n] = static_cast<T>(value);
+        }
+    }
+    return A;
+}
+
 template<typename T>
 class FixedPointConverter {
 public:
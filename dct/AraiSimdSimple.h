@@ -3,23 +3,41 @@
 
 #include <Vc/Vc>
 #include <Vc/IO>
-#include <math.h>
+#include <array>
 #include "AbstractCosinusTransform.h"
 
-#define a1 0.707106781186547524400844362104849039284835937688474036588
-#define a2 0.541196100146196984399723205366389420061072063378015444681
-#define a3 0.707106781186547524400844362104849039284835937688474036588
-#define a4 1.306562964876376527856643173427187153583761188349269527548
-#define a5 0.382683432365089771728459984030398866761344562485627041433
-
-#define s0 0.353553390593273762200422181052424519642417968844237018294
-#define s1 0.254897789552079584470969901993921956841309245954467684863
-#define s2 0.270598050073098492199861602683194710030536031689007722340
-#define s3 0.300672443467522640271860911954610917533627944800336361060
-#define s4 0.353553390593273762200422181052424519642417968844237018294
-#define s5 0.449988111568207852319254770470944197769000863706422492617
-#define s6 0.653281482438188263928321586713593576791880594174634763774
-#define s7 1.281457723870753089398043148088849954507561675693672456063
+/**
+ * The AAN factors a1..a5 (a0 is unused): a1 = a3 = cos(4pi/16), a2 = cos(2pi/16) - cos(6pi/16),
+ * a4 = cos(2pi/16) + cos(6pi/16), a5 = cos(6pi/16)
+ */
+template<typename T>
+constexpr std::array<T, 6> generateAraiFactors() {
+    const double c2 = constexprCos(2 * constexprPi / 16);
+    const double c4 = constexprCos(4 * constexprPi / 16);
+    const double c6 = constexprCos(6 * constexprPi / 16);
+
+    return {
+            0,
+            FixedPointConverter<T>::convert(c4),
+            FixedPointConverter<T>::convert(c2 - c6),
+            FixedPointConverter<T>::convert(c4),
+            FixedPointConverter<T>::convert(c2 + c6),
+            FixedPointConverter<T>::convert(c6)
+    };
+}
+
+/**
+ * The output scale factors s0 = 1 / (2 * sqrt(2)) and sk = 1 / (4 * cos(k * pi/16))
+ */
+template<typename T>
+constexpr std::array<T, 8> generateAraiScales() {
+    std::array<T, 8> s {};
+    s[0] = FixedPointConverter<T>::convert(1. / (2. * constexprSqrt(2.)));
+    for (int k = 1; k < 8; ++k) {
+        s[k] = FixedPointConverter<T>::convert(1. / (4. * constexprCos(k * constexprPi / 16)));
+    }
+    return s;
+}
 
 template<typename T, unsigned int blocksize = 8>
 class AraiSimdSimple {
@@ -27,26 +45,8 @@ private:
     using vec8 = Vc::fixed_size_simd<T, blocksize>;
     using rowBlock = std::array<vec8, blocksize>;
 
-    std::array<T, 6> a = {
-            0,
-            FixedPointConverter<T>::convert(a1),
-            FixedPointConverter<T>::convert(a2),
-            FixedPointConverter<T>::convert(a3),
-            FixedPointConverter<T>::convert(a4),
-            FixedPointConverter<T>::convert(a5)
-    };
-
-
-    std::array<T, 8> s = {
-            FixedPointConverter<T>::convert(s0),
-            FixedPointConverter<T>::convert(s1),
-            FixedPointConverter<T>::convert(s2),
-            FixedPointConverter<T>::convert(s3),
-            FixedPointConverter<T>::convert(s4),
-            FixedPointConverter<T>::convert(s5),
-            FixedPointConverter<T>::convert(s6),
-            FixedPointConverter<T>::convert(s7)
-    };
+    alignas(64) static constexpr std::array<T, 6> a = generateAraiFactors<T>();
+    alignas(64) static constexpr std::array<T, 8> s = generateAraiScales<T>();
 
     vec8 y0,y1,y2,y3,y4,y5,y6,y7 = 0;
     vec8 ty0, ty1, ty2, ty3, ty4, ty5, ty6, ty7 = 0;
@@ -110,12 +110,12 @@ public:
         y4 = ty4;
 
         ty4 = y4*a[2] - ((ty6-y4)*a[5]);
-        ty6 = ty6*a[4] - ((ty6+y4)*a[5]);
+        ty6 = ty6*a[4] - ((ty6-y4)*a[5]);
 
         y2 = ty2 + ty3;
         ty3 = (ty3 - ty2) * s[6];
         y5 = (ty5 * a[3]) + y7;
-        y7 = y7 - ty5;
+        y7 = y7 - (ty5*a[3]);
 
         ty1 = y1 * s[4];
         ty2 = y2 * s[2];
@@ -150,12 +150,12 @@ public:
         y4 = ty4;
 
         ty4 = y4*a[2] - ((ty6-y4)*a[5]);
-        ty6 = ty6*a[4] - ((ty6+y4)*a[5]);
+        ty6 = ty6*a[4] - ((ty6-y4)*a[5]);
 
         y2 = ty2 + ty3;
         ty3 = (ty3 - ty2) * s[6];
         y5 = (ty5 * a[3]) + y7;
-        y7 = y7 - ty5;
+        y7 = y7 - (ty5*a[3]);
 
         ty1 = y1 * s[4];
         ty2 = y2 * s[2];
@@ -177,16 +177,16 @@ public:
     }
 
     template<typename CoordType>
-    void transformBlock(rowBlock& block, const std::function<void (const CoordType, const CoordType, const T)>& set) {
-
-        vec8& y0 = block[0];
-        vec8& y1 = block[1];
-        vec8& y2 = block[2];
-        vec8& y3 = block[3];
-        vec8& y4 = block[4];
-        vec8& y5 = block[5];
-        vec8& y6 = block[6];
-        vec8& y7 = block[7];
+    void transformBlock(const rowBlock& block, const std::function<void (const CoordType, const CoordType, const T)>& set) {
+        // work on copies, the block stays intact for modes that transform it twice
+        y0 = block[0];
+        y1 = block[1];
+        y2 = block[2];
+        y3 = block[3];
+        y4 = block[4];
+        y5 = block[5];
+        y6 = block[6];
+        y7 = block[7];
 
         ty4 = y4;
         ty5 = y5;
@@ -218,12 +218,12 @@ public:
         y4 = ty4;
 
         ty4 = y4*a[2] - ((ty6-y4)*a[5]);
-        ty6 = ty6*a[4] - ((ty6+y4)*a[5]);
+        ty6 = ty6*a[4] - ((ty6-y4)*a[5]);
 
         y2 = ty2 + ty3;
         ty3 = (ty3 - ty2) * s[6];
         y5 = (ty5 * a[3]) + y7;
-        y7 = y7 - ty5;
+        y7 = y7 - (ty5*a[3]);
 
         ty1 = y1 * s[4];
         ty2 = y2 * s[2];
@@ -258,12 +258,12 @@ public:
         y4 = ty4;
 
         ty4 = y4*a[2] - ((ty6-y4)*a[5]);
-        ty6 = ty6*a[4] - ((ty6+y4)*a[5]);
+        ty6 = ty6*a[4] - ((ty6-y4)*a[5]);
 
         y2 = ty2 + ty3;
         ty3 = (ty3 - ty2) * s[6];
         y5 = (ty5 * a[3]) + y7;
-        y7 = y7 - ty5;
+        y7 = y7 - (ty5*a[3]);
 
         ty1 = y1 * s[4];
         ty2 = y2 * s[2];
@@ -273,14 +273,14 @@ public:
         ty6 = (y5 - ty6) * s[7];
 
         for(CoordType i = 0; i < 8; i++) {
-            set(i, 0, ty0[i]);
-            set(i, 4, ty1[i]);
-            set(i, 2, ty2[i]);
-            set(i, 6, ty3[i]);
-            set(i, 5, ty4[i]);
-            set(i, 1, ty5[i]);
-            set(i, 7, ty6[i]);
-            set(i, 3, ty7[i]);
+            set(0, i, ty0[i]);
+            set(4, i, ty1[i]);
+            set(2, i, ty2[i]);
+            set(6, i, ty3[i]);
+            set(5, i, ty4[i]);
+            set(1, i, ty5[i]);
+            set(7, i, ty6[i]);
+            set(3, i, ty7[i]);
         }
     }
 };
@@ -1,46 +1,44 @@
 #ifndef MEDIENINFO_DISCRETECOSINTRANSFORM_H
 #define MEDIENINFO_DISCRETECOSINTRANSFORM_H
 
-#include <math.h>
+#include <Vc/Vc>
 #include <array>
 #include "../Image.h"
 #include "AbstractCosinusTransform.h"
 
-template<typename T, unsigned int blocksize = 8>
-class DirectCosinusTransform {
-private:
-    double C(int value) const {
-        if (value == 0) {
-            return 1/sqrt(2);
-        } else {
-            return 1;
-        }
-    }
-
-    std::array<std::array<std::array<std::array<T, blocksize>, blocksize>, blocksize>, blocksize> coefficients;
-    void buildBuffer() {
-        for (unsigned int i = 0; i < blocksize; i++) {
-            const double ci = ((i * M_PI) / (2. * blocksize));
-
-            for (unsigned int j = 0; j < blocksize; j++) {
-                const double cj = (j * M_PI) / (2. * blocksize);
-
-                for (unsigned int x = 0; x < blocksize; x++) {
-                    for (unsigned int y = 0; y < blocksize; y++) {
-                        coefficients[x][y][i][j] =
-                                (2./blocksize)*C(i)*C(j) * cos(((x << 1)+1)*ci) * cos(((y << 1) + 1) * cj);
-                    }
+/**
+ * The basis functions of the 2D DCT, coefficients[x][y][i][j] = A(i, x) * A(j, y)
+ */
+template<typename T, unsigned int blocksize>
+constexpr std::array<std::array<std::array<std::array<T, blocksize>, blocksize>, blocksize>, blocksize> generateDirectCoefficients() {
+    constexpr auto A = generateDctMatrix<double, blocksize>();
+    std::array<std::array<std::array<std::array<T, blocksize>, blocksize>, blocksize>, blocksize> coefficients {};
+
+    for (unsigned int x = 0; x < blocksize; x++) {
+        for (unsigned int y = 0; y < blocksize; y++) {
+            for (unsigned int i = 0; i < blocksize; i++) {
+                for (unsigned int j = 0; j < blocksize; j++) {
+                    coefficients[x][y][i][j] = static_cast<T>(A[i][x] * A[j][y]);
                 }
-
             }
         }
     }
+    return coefficients;
+}
+
+template<typename T, unsigned int blocksize = 8>
+class DirectCosinusTransform {
+private:
+    using vec = Vc::fixed_size_simd<T, blocksize>;
+
+    // 16kb for floats, shared between all instances
+    alignas(64) static constexpr std::array<std::array<std::array<std::array<T, blocksize>, blocksize>, blocksize>, blocksize>
+            coefficients = generateDirectCoefficients<T, blocksize>();
 
-    std::array<std::array<T, blocksize>, blocksize> sums = { 0 };
 public:
 
-    void transformBlock(const std::function<const T&(uint, uint)>& get, const std::function<T&(uint, uint)>& set) {
-        sums = { 0 };
+    void transformBlock(const std::function<const T&(uint, uint)>& get, const std::function<T&(uint, uint)>& set) const {
+        std::array<std::array<T, blocksize>, blocksize> sums = { 0 };
 
         for (unsigned int x = 0; x < blocksize; x++) {
             const auto& rowX = coefficients[x];
@@ -65,32 +63,30 @@ public:
     }
 
     template<typename CoordType>
-    void transformBlock(typename Block<T>::rowBlock& block, const std::function<void (const CoordType, const CoordType, const T)>& set) {
-        sums = { 0 };
+    void transformBlock(typename Block<T>::rowBlock& block, const std::function<void (const CoordType, const CoordType, const T)>& set) const {
+        std::array<vec, blocksize> rows;
+        for (auto& row : rows)
+            row = 0;
 
         for (unsigned int x = 0; x < blocksize; x++) {
             const auto& rowX = coefficients[x];
             for (unsigned int y = 0; y < blocksize; y++) {
-                const auto& value = block[y][x];
+                const vec value(static_cast<T>(block[y][x]));
                 const auto& rowY = rowX[y];
 
                 for (unsigned int i = 0; i < blocksize; i++) {
-                    const auto& rowI = rowY[i];
-                    for (unsigned int j = 0; j < blocksize; j++) {
-                        sums[i][j] += value * rowI[j];
-                    }
+                    rows[i] = Vc::fma(vec(&rowY[i][0], Vc::Aligned), value, rows[i]);
                 }
             }
         }
 
         for (CoordType i = 0; i < blocksize; i++) {
+            const auto& row = rows[i];
             for (CoordType j = 0; j < blocksize; j++) {
-                set(i, j, sums[i][j]);
+                set(i, j, row[j]);
             }
         }
     }
-
-    DirectCosinusTransform() { buildBuffer(); }
 };
 
 
@@ -0,0 +1,159 @@
+#ifndef MEDIENINFO_LOEFFLERSIMD_H
+#define MEDIENINFO_LOEFFLERSIMD_H
+
+#include <Vc/Vc>
+#include <array>
+#include <functional>
+#include <type_traits>
+#include "AbstractCosinusTransform.h"
+
+/**
+ * Converts a constant of the flow graph to T, fixed point types get the given amount of fractional bits.
+ */
+template<typename T, int bits>
+constexpr T loefflerConstant(const double c) {
+    if (!std::is_integral<T>::value)
+        return static_cast<T>(c);
+
+    const double scaled = c * (1 << bits);
+    return static_cast<T>(scaled < 0 ? scaled - 0.5 : scaled + 0.5);
+}
+
+/**
+ * Loeffler-Ligtenberg-Moschytz DCT, which needs 11 multiplications per 1D transform (AAN needs 5 plus 8 for the
+ * scaling, the separated one 64). Unlike AAN every output coefficient passes through at most two multiplications,
+ * which keeps the fixed point variant accurate.
+ *
+ * T is the type used for the calculation (float or int32_t), the blocks and the output use StorageType like the rest
+ * of the pipeline. The output is the orthonormal DCT, scaled like SeparatedCosinusTransform.
+ */
+template<typename T, typename StorageType = float>
+class LoefflerSimd {
+private:
+    using vec8 = Vc::fixed_size_simd<T, 8>;
+    using storageVec8 = Vc::fixed_size_simd<StorageType, 8>;
+    using rowBlock = std::array<storageVec8, 8>;
+    using workBlock = std::array<vec8, 8>;
+
+    static constexpr bool fixedPoint = std::is_integral<T>::value;
+    // fractional bits of the fixed point constants
+    static constexpr int constBits = 13;
+    // fractional bits of the fixed point samples, this keeps the quarter values of the subsampled chroma blocks
+    static constexpr int sampleBits = fixedPoint ? 2 : 0;
+
+    template<int k>
+    static constexpr double rotationCos = constexprCos(k * constexprPi / 16);
+    template<int k>
+    static constexpr double rotationSin = constexprCos((8 - k) * constexprPi / 16);
+
+    // constants for the three rotations of the flow graph. Every rotation is calculated with three multiplications:
+    // t = (a + b) * cos; a' = t + b * (sin - cos); b' = t - a * (cos + sin)
+    // the even rotation is additionally scaled by sqrt(2)
+    static constexpr T r6Cos = loefflerConstant<T, constBits>(constexprSqrt(2.) * rotationCos<6>);
+    static constexpr T r6SinCos = loefflerConstant<T, constBits>(constexprSqrt(2.) * (rotationSin<6> - rotationCos<6>));
+    static constexpr T r6CosSin = loefflerConstant<T, constBits>(constexprSqrt(2.) * (rotationCos<6> + rotationSin<6>));
+    static constexpr T r3Cos = loefflerConstant<T, constBits>(rotationCos<3>);
+    static constexpr T r3SinCos = loefflerConstant<T, constBits>(rotationSin<3> - rotationCos<3>);
+    static constexpr T r3CosSin = loefflerConstant<T, constBits>(rotationCos<3> + rotationSin<3>);
+    static constexpr T r1Cos = loefflerConstant<T, constBits>(rotationCos<1>);
+    static constexpr T r1SinCos = loefflerConstant<T, constBits>(rotationSin<1> - rotationCos<1>);
+    static constexpr T r1CosSin = loefflerConstant<T, constBits>(rotationCos<1> + rotationSin<1>);
+    static constexpr T sqrt2 = loefflerConstant<T, constBits>(constexprSqrt(2.));
+
+    static inline vec8 mul(const vec8& v, const T c) {
+        if constexpr (fixedPoint) {
+            // round to nearest while descaling
+            return (v * c + (1 << (constBits - 1))) >> constBits;
+        }
+        else {
+            return v * c;
+        }
+    }
+
+    /**
+     * 1D transform of all 8 lanes at once. The results are scaled by sqrt(8) and stored in natural order.
+     */
+    inline void transform1D(workBlock& v) const {
+        const vec8 t0 = v[0] + v[7];
+        const vec8 t1 = v[1] + v[6];
+        const vec8 t2 = v[2] + v[5];
+        const vec8 t3 = v[3] + v[4];
+        const vec8 t4 = v[3] - v[4];
+        const vec8 t5 = v[2] - v[5];
+        const vec8 t6 = v[1] - v[6];
+        const vec8 t7 = v[0] - v[7];
+
+        // even part
+        const vec8 e0 = t0 + t3;
+        const vec8 e1 = t1 + t2;
+        const vec8 e2 = t1 - t2;
+        const vec8 e3 = t0 - t3;
+
+        v[0] = e0 + e1;
+        v[4] = e0 - e1;
+
+        const vec8 re = mul(e2 + e3, r6Cos);
+        v[2] = re + mul(e3, r6SinCos);
+        v[6] = re - mul(e2, r6CosSin);
+
+        // odd part
+        const vec8 r3 = mul(t4 + t7, r3Cos);
+        const vec8 o4 = r3 + mul(t7, r3SinCos);
+        const vec8 o7 = r3 - mul(t4, r3CosSin);
+
+        const vec8 r1 = mul(t5 + t6, r1Cos);
+        const vec8 o5 = r1 + mul(t6, r1SinCos);
+        const vec8 o6 = r1 - mul(t5, r1CosSin);
+
+        const vec8 p4 = o4 + o6;
+        const vec8 p6 = o4 - o6;
+        const vec8 p7 = o7 + o5;
+        const vec8 p5 = o7 - o5;
+
+        v[1] = p7 + p4;
+        v[7] = p7 - p4;
+        v[3] = mul(p5, sqrt2);
+        v[5] = mul(p6, sqrt2);
+    }
+
+    static inline void transpose(workBlock& v) {
+        for (uint i = 0; i < 8; ++i) {
+            for (uint j = i + 1; j < 8; ++j) {
+                const T temp = v[i][j];
+                v[i][j] = v[j][i];
+                v[j][i] = temp;
+            }
+        }
+    }
+
+public:
+    template<typename CoordType>
+    void transformBlock(rowBlock& block, const std::function<void (const CoordType, const CoordType, const StorageType)>& set) const {
+        workBlock v;
+        for (uint y = 0; y < 8; ++y) {
+            if constexpr (fixedPoint) {
+                v[y] = Vc::simd_cast<vec8>(Vc::round(block[y] * static_cast<StorageType>(1 << sampleBits)));
+            }
+            else {
+                v[y] = Vc::simd_cast<vec8>(block[y]);
+            }
+        }
+
+        // the rows are col-major, so the first pass transforms all columns at once
+        transform1D(v);
+        transpose(v);
+        // now every vector contains one column of vertical frequencies
+        transform1D(v);
+
+        // both passes scaled the result by sqrt(8)
+        const StorageType scale = static_cast<StorageType>(1.) / (8 << sampleBits);
+        for (CoordType x = 0; x < 8; ++x) {
+            const storageVec8 row = Vc::simd_cast<storageVec8>(v[x]) * scale;
+            for (CoordType y = 0; y < 8; ++y) {
+                set(x, y, row[y]);
+            }
+        }
+    }
+};
+
+#endif //MEDIENINFO_LOEFFLERSIMD_H
@@ -1,94 +1,79 @@
 #ifndef MEDIENINFO_SEPARATEDCOSINUSTRANSFORMGLM_H
 #define MEDIENINFO_SEPARATEDCOSINUSTRANSFORMGLM_H
 
-
-#include <boost/numeric/ublas/io.hpp>
-#include <boost/numeric/ublas/matrix.hpp>
-#include <boost/numeric/ublas/matrix_proxy.hpp>
-#include <boost/numeric/ublas/operation_blocked.hpp>
+#include <Vc/Vc>
+#include <array>
+#include <functional>
 #include "AbstractCosinusTransform.h"
 
-
+/**
+ * Calculates the DCT as Y = A * X * A^T with two SIMD matrix products. This is the "reference" transform, it is as
+ * accurate as the direct one but only needs 2 * 64 fused multiply-adds per block.
+ */
 template<typename T, unsigned int blocksize = 8>
 class SeparatedCosinusTransform {
 private:
-    using mat8x8 = boost::numeric::ublas::matrix<T>;
-    const mat8x8 A = generateA();
-    const mat8x8 AT = generateAT();
-
-
-    constexpr double C(int n) const {
-        if(n == 0) {
-            return 1/sqrt(2);
-        }
-        return 1.;
-    }
-
-    constexpr mat8x8 generateA() const {
-        mat8x8 A(8, 8);
-        const T N = blocksize;
-        const double prefix = sqrt(2./N);
-
-        for (uint k = 0; k < blocksize; ++k) {
-            for (uint n = 0; n < blocksize; ++n) {
-                A(k, n) = C(k) * prefix * cos(((n << 1) + 1) * (k * M_PI) / (2*N) );
+    using vec = Vc::fixed_size_simd<T, blocksize>;
+    using rowBlock = std::array<vec, blocksize>;
+    using matrix = std::array<std::array<T, blocksize>, blocksize>;
+
+    // A is only read as scalar factors, the rows of A^T are loaded as vectors
+    alignas(64) static constexpr matrix A = generateDctMatrix<T, blocksize>();
+    alignas(64) static constexpr matrix AT = generateDctMatrix<T, blocksize>(true);
+
+    /**
+     * Transforms the block in place. The rows of the block are the rows of the image (X^T), the rows of the result
+     * contain the horizontal frequencies for one vertical frequency each (Y^T).
+     */
+    inline void transform(rowBlock& block) const {
+        // W = A * X^T, every row of W is a linear combination of the image rows
+        rowBlock W;
+        for (uint v = 0; v < blocksize; ++v) {
+            vec sum = block[0] * A[v][0];
+            for (uint m = 1; m < blocksize; ++m) {
+                sum = Vc::fma(block[m], vec(A[v][m]), sum);
             }
+            W[v] = sum;
         }
 
-        return A;
-    }
-
-    constexpr mat8x8 generateAT() const {
-        return boost::numeric::ublas::trans(generateA());
-    }
-
-    void generateMatFromChannel(const std::function<const T&(uint, uint)>& get, mat8x8& matrix) const {
-        for (uint y = 0; y < blocksize; ++y) {
-            for (uint x = 0; x < blocksize; ++x) {
-                matrix(x, y) = get(x, y);
+        // Y^T = W * A^T, every row of Y^T is a linear combination of the rows of A^T
+        for (uint v = 0; v < blocksize; ++v) {
+            const auto& row = W[v];
+            vec sum = vec(&AT[0][0], Vc::Aligned) * row[0];
+            for (uint n = 1; n < blocksize; ++n) {
+                sum = Vc::fma(vec(&AT[n][0], Vc::Aligned), vec(row[n]), sum);
             }
+            block[v] = sum;
         }
     }
 
-    void writeMat(const std::function<T&(uint, uint)>& set, mat8x8& matrix) const {
+public:
+    void transformBlock(const std::function<const T&(uint, uint)>& get, const std::function<T&(uint, uint)>& set) const {
+        rowBlock block;
         for (uint y = 0; y < blocksize; ++y) {
             for (uint x = 0; x < blocksize; ++x) {
-                set(x, y) = matrix(x, y);
+                block[y][x] = get(x, y);
             }
         }
-    }
-
-public:
-    void transformBlock(const std::function<const T&(uint, uint)>& get, const std::function<T&(uint, uint)>& set) const {
-        using namespace boost::numeric::ublas;
 
-        mat8x8 X(8,8);
-        generateMatFromChannel(get, X);
-        mat8x8 Y(8,8);
+        transform(block);
 
-        Y = block_prod<matrix<T>, 1024>(block_prod<matrix<T>, 1024>(A, X), AT);
-
-        writeMat(set, Y);
-    }
-
-    template<typename CoordType>
-    void transformBlock(typename Block<T>::rowBlock& block, const std::function<void (const CoordType, const CoordType, const T)>& set) {
-        using namespace boost::numeric::ublas;
-
-        mat8x8 X(8,8);
         for (uint y = 0; y < blocksize; ++y) {
             for (uint x = 0; x < blocksize; ++x) {
-                X(x, y) = block[y][x];
+                set(x, y) = block[y][x];
             }
         }
+    }
 
-        mat8x8 Y(8,8);
-        Y = block_prod<matrix<T>, 1024>(block_prod<matrix<T>, 1024>(A, X), AT);
-
-
-        for (uint y = 0; y < blocksize; ++y) {
-            for (uint x = 0; x < blocksize; ++x) {
-                set(x, y, Y(x, y));
+    template<typename CoordType>
+    void transformBlock(rowBlock& block, const std::function<void (const CoordType, const CoordType, const T)>& set) const {
+        rowBlock Y = block;
+        transform(Y);
+
+        for (CoordType y = 0; y < blocksize; ++y) {
+            const auto& row = Y[y];
+            for (CoordType x = 0; x < blocksize; ++x) {
+                set(x, y, row[x]);
             }
         }
     }
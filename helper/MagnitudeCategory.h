@@ -0,0 +1,57 @@
+#ifndef MEDIENINFO_MAGNITUDECATEGORY_H
+#define MEDIENINFO_MAGNITUDECATEGORY_H
+
+#include <Vc/Vc>
+#include <array>
+#include <cstdint>
+#include <immintrin.h>
+
+/**
+ * JPEG size category of a coefficient (the amount of bits of its magnitude, 0 for 0). lzcnt returns 32 for 0, so
+ * there is no branch.
+ */
+static inline uint8_t magnitudeCategory(const int16_t value) {
+    const uint32_t magnitude = static_cast<uint32_t>(value < 0 ? -value : value);
+    return static_cast<uint8_t>(32 - _lzcnt_u32(magnitude));
+}
+
+/**
+ * The extra bits written after the Huffman code: the value itself when positive, the one's complement of the
+ * magnitude when negative (which is value - 1 in two's complement).
+ */
+static inline uint16_t magnitudeBits(const int16_t value, const uint8_t category) {
+    const int32_t v = value;
+    return static_cast<uint16_t>((v + (v >> 31)) & ((1u << category) - 1));
+}
+
+/**
+ * Categories and extra bits of all 64 coefficients of a block at once, eight coefficients per step. The bit length
+ * is taken from the exponent of the magnitude converted to float, which is exact for the 16 bit coefficients.
+ */
+static inline void magnitudeCategories(const int16_t* values, std::array<uint16_t, 64>& categories, std::array<uint16_t, 64>& bits) {
+    using ivec8 = Vc::fixed_size_simd<int32_t, 8>;
+    using fvec8 = Vc::fixed_size_simd<float, 8>;
+    using svec8 = Vc::fixed_size_simd<int16_t, 8>;
+    using uvec8 = Vc::fixed_size_simd<uint16_t, 8>;
+
+    for (unsigned int i = 0; i < 64; i += 8) {
+        const ivec8 v = Vc::simd_cast<ivec8>(svec8(values + i, Vc::Unaligned));
+        const ivec8 magnitude = Vc::abs(v);
+
+        // exponent(x) is floor(log2(x)), the zero lanes are masked afterwards
+        ivec8 category = Vc::simd_cast<ivec8>(Vc::exponent(Vc::simd_cast<fvec8>(Vc::max(magnitude, ivec8(1))))) + 1;
+        category.setZero(magnitude == 0);
+
+        // smearing the highest bit down gives (1 << category) - 1 without a variable shift
+        ivec8 ones = magnitude | (magnitude >> 1);
+        ones |= ones >> 2;
+        ones |= ones >> 4;
+        ones |= ones >> 8;
+        const ivec8 extra = (v + (v >> 31)) & ones;
+
+        Vc::simd_cast<uvec8>(category).store(&categories[i], Vc::Unaligned);
+        Vc::simd_cast<uvec8>(extra).store(&bits[i], Vc::Unaligned);
+    }
+}
+
+#endif //MEDIENINFO_MAGNITUDECATEGORY_H
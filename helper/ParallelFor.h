@@ -17,6 +17,8 @@
 template<int threads = 4>
 class ParallelFor {
 public:
+    static constexpr int threadAmount = threads;
+
     class Task {
     public:
         std::promise<void>& awake;
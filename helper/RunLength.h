@@ -0,0 +1,61 @@
+#ifndef MEDIENINFO_RUNLENGTH_H
+#define MEDIENINFO_RUNLENGTH_H
+
+#include <array>
+#include <cstdint>
+#include <immintrin.h>
+#include "MagnitudeCategory.h"
+
+// the AC symbols without a size: end of block and a run of 16 zeros
+static constexpr uint8_t endOfBlockSymbol = 0x00;
+static constexpr uint8_t zeroRunSymbol = 0xF0;
+// blocks with more non zero AC coefficients get their categories from magnitudeCategories
+static constexpr int denseBlockThreshold = 24;
+
+/**
+ * Run length encodes a block (DC first, the AC coefficients in zigzag order) like F.1.2 of ISO/IEC 10918-1. The DC
+ * difference to previousDc goes to dcSink(size, bits), the AC symbols to acSink(symbol, size, bits). Only the non zero
+ * coefficients of nonZeroMask are visited, so an all zero block is just the DC and the EOB. Without withBits the extra
+ * bits are passed as 0, which is enough for counting the symbols. categories and extraBits are scratch space.
+ */
+template<bool withBits, typename DcSink, typename AcSink>
+static inline void runLengthEncodeBlock(const int16_t* values, const int16_t previousDc, const uint64_t nonZeroMask,
+                                        std::array<uint16_t, 64>& categories, std::array<uint16_t, 64>& extraBits,
+                                        DcSink&& dcSink, AcSink&& acSink) {
+    const int16_t difference = static_cast<int16_t>(values[0] - previousDc);
+    const uint8_t dcSize = magnitudeCategory(difference);
+    dcSink(dcSize, withBits ? magnitudeBits(difference, dcSize) : static_cast<uint16_t>(0));
+
+    uint64_t mask = nonZeroMask >> 1;
+
+    // for dense blocks the categories of the whole block are calculated at once, counting only needs them with the bits
+    const bool dense = withBits && _mm_popcnt_u64(mask) > denseBlockThreshold;
+    if (dense) {
+        magnitudeCategories(values, categories, extraBits);
+    }
+
+    unsigned int next = 0;
+    while (mask != 0) {
+        const unsigned int index = static_cast<unsigned int>(_tzcnt_u64(mask));
+        unsigned int amountZeros = index - next;
+        while (amountZeros > 15) {
+            acSink(zeroRunSymbol, static_cast<uint8_t>(0), static_cast<uint16_t>(0));
+            amountZeros -= 16;
+        }
+
+        const int16_t value = values[index + 1];
+        const uint8_t size = dense ? static_cast<uint8_t>(categories[index + 1]) : magnitudeCategory(value);
+        const uint16_t bits = withBits ? (dense ? extraBits[index + 1] : magnitudeBits(value, size)) : 0;
+        acSink(static_cast<uint8_t>((amountZeros << 4) | size), size, bits);
+
+        next = index + 1;
+        mask &= mask - 1;
+    }
+
+    // EOB unless the last coefficient was written
+    if (next != 63) {
+        acSink(endOfBlockSymbol, static_cast<uint8_t>(0), static_cast<uint16_t>(0));
+    }
+}
+
+#endif //MEDIENINFO_RUNLENGTH_H
@@ -0,0 +1,64 @@
+#ifndef MEDIENINFO_SPSCQUEUE_H
+#define MEDIENINFO_SPSCQUEUE_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <thread>
+
+/**
+ * Bounded lock-free queue for exactly one producer and one consumer thread. head is only written by the consumer and
+ * tail only by the producer, so an acquire load of the other index is all the synchronisation needed. The indices
+ * count up forever and are masked, capacity has to be a power of two.
+ */
+template<typename T, size_t capacity>
+class SpscQueue {
+private:
+    static_assert(capacity > 0 && (capacity & (capacity - 1)) == 0, "the capacity has to be a power of two");
+    static constexpr size_t mask = capacity - 1;
+
+    std::array<T, capacity> items;
+    // on their own cache lines, so the threads do not invalidate each other's index
+    alignas(64) std::atomic<size_t> head { 0 };
+    alignas(64) std::atomic<size_t> tail { 0 };
+
+public:
+    bool tryPush(const T& item) {
+        const size_t position = tail.load(std::memory_order_relaxed);
+        if (position - head.load(std::memory_order_acquire) == capacity) {
+            return false;
+        }
+
+        items[position & mask] = item;
+        tail.store(position + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool tryPop(T& item) {
+        const size_t position = head.load(std::memory_order_relaxed);
+        if (position == tail.load(std::memory_order_acquire)) {
+            return false;
+        }
+
+        item = items[position & mask];
+        head.store(position + 1, std::memory_order_release);
+        return true;
+    }
+
+    // spins until there is space, yielding so it also works with fewer cores than threads
+    void push(const T& item) {
+        while (!tryPush(item)) {
+            std::this_thread::yield();
+        }
+    }
+
+    T pop() {
+        T item;
+        while (!tryPop(item)) {
+            std::this_thread::yield();
+        }
+        return item;
+    }
+};
+
+#endif //MEDIENINFO_SPSCQUEUE_H
@@ -17,29 +17,141 @@
 #include "segments/SOS.h"
 #include "dct/AraiSimdSimple.h"
 #include "dct/DirectCosinusTransform.h"
+#include "EncoderRegistry.h"
 
 const unsigned int stepSize = 8;
 
-void full_encode(int runtime, bool exportChannels = false, const string path = "../output/test");
+// settings passed on to the encoder engine
+struct EncodeOptions {
+    // 0 keeps the default tables
+    int quality = 0;
+    bool trellis = false;
+    // MCUs between two restart markers, 0 writes none
+    unsigned int restartInterval = 0;
+    bool standardTables = false;
+    bool coefficientScan = false;
+    // statistics from every n-th row of MCUs, 0 uses all of them
+    unsigned int sampleRows = 0;
+    // trained Huffman tables, nullptr builds them for every image
+    std::shared_ptr<const HuffmanTableProfile> profile;
+    bool arithmeticCoding = false;
+    // scans of a progressive image, nullptr writes a baseline image
+    std::shared_ptr<const ScanScript> scanScript;
+    // print the size predicted from the symbol histograms before encoding
+    bool predictSize = false;
+    // the input is a baseline JPEG whose coefficients are written again with optimised tables
+    bool reoptimise = false;
+};
+
+void full_encode(int runtime, bool exportChannels = false, const string path = "../output/test",
+                 const std::string& engine = EncoderRegistry::defaultEngine, const EncodeOptions& options = {});
+
+void full_reoptimise(int runtime, const std::string& path, const std::string& engine, const EncodeOptions& options);
 
 int main(int argc, char* argv[]) {
     std::cout << argv[0] << std::endl;
-    if(argc < 2) {
-        std::cerr << "Usage: ./Medieninfo path.ppm [runtime in s]"
+
+    // options come before the positional arguments
+    std::string engine = EncoderRegistry::defaultEngine;
+    EncodeOptions options;
+    int arg = 1;
+    for (; arg < argc && std::string(argv[arg]).rfind("--", 0) == 0; ++arg) {
+        const std::string option = argv[arg];
+        if (option.rfind("--engine=", 0) == 0) {
+            engine = option.substr(9);
+        } else if (option.rfind("--quality=", 0) == 0) {
+            options.quality = atoi(option.substr(10).c_str());
+            if (options.quality < 1 || options.quality > 100) {
+                std::cerr << "The quality has to be between 1 and 100" << std::endl;
+                return 1;
+            }
+        } else if (option == "--trellis") {
+            options.trellis = true;
+        } else if (option == "--standard-tables") {
+            options.standardTables = true;
+        } else if (option == "--coefficient-scan") {
+            options.coefficientScan = true;
+        } else if (option.rfind("--sample-rows=", 0) == 0) {
+            const int rows = atoi(option.substr(14).c_str());
+            if (rows < 0) {
+                std::cerr << "The sampled row step can not be negative" << std::endl;
+                return 1;
+            }
+            options.sampleRows = static_cast<unsigned int>(rows);
+        } else if (option == "--progressive") {
+            options.scanScript = std::make_shared<const ScanScript>(ScanScript::standard());
+        } else if (option.rfind("--scan-script=", 0) == 0) {
+            try {
+                options.scanScript = std::make_shared<const ScanScript>(ScanScript::load(option.substr(14)));
+            } catch (std::runtime_error& e) {
+                std::cerr << e.what() << std::endl;
+                return 1;
+            }
+        } else if (option == "--arithmetic") {
+            options.arithmeticCoding = true;
+        } else if (option == "--predict-size") {
+            options.predictSize = true;
+        } else if (option == "--reoptimise") {
+            options.reoptimise = true;
+        } else if (option.rfind("--profile=", 0) == 0) {
+            try {
+                options.profile = std::make_shared<const HuffmanTableProfile>(HuffmanTableProfile::load(option.substr(10)));
+            } catch (std::runtime_error& e) {
+                std::cerr << e.what() << std::endl;
+                return 1;
+            }
+        } else if (option.rfind("--restart=", 0) == 0) {
+            const int interval = atoi(option.substr(10).c_str());
+            if (interval < 0 || interval > 0xFFFF) {
+                std::cerr << "The restart interval has to be between 0 and 65535" << std::endl;
+                return 1;
+            }
+            options.restartInterval = static_cast<unsigned int>(interval);
+        } else if (option == "--list-engines") {
+            for (const auto& entry : EncoderRegistry::engines()) {
+                std::cout << entry.name << "\n";
+            }
+            return 0;
+        } else {
+            std::cerr << "Unknown option " << option << std::endl;
+            return 1;
+        }
+    }
+
+    // a profile fits the quantisation it was trained with best
+    if (options.profile && options.quality == 0) {
+        options.quality = options.profile->quality;
+    }
+
+    // the coefficients of the input are kept, so only the options of the entropy coding apply
+    if (options.reoptimise && (options.quality != 0 || options.trellis || options.standardTables || options.coefficientScan
+                               || options.sampleRows != 0 || options.arithmeticCoding || options.predictSize)) {
+        std::cerr << "--reoptimise only takes --engine, --restart, --progressive and --scan-script" << std::endl;
+        return 1;
+    }
+
+    if(argc - arg < 1) {
+        std::cerr << "Usage: ./Medieninfo [--engine=name] [--quality=1..100] [--trellis] [--restart=mcus] [--standard-tables] [--coefficient-scan] [--sample-rows=n] [--profile=file] [--arithmetic] [--progressive] [--scan-script=file] [--predict-size] [--list-engines] path.ppm [runtime in s]\n"
+                  << "       ./Medieninfo --reoptimise [--engine=name] [--restart=mcus] [--progressive] [--scan-script=file] path.jpg [runtime in s]"
                   << std::endl;
         return 1;
     }
-    std::string pathToFile = argv[1];
-    if (argc == 3) {
-        int runs = atoi(argv[2]);
-        full_encode(runs * 1000, false, pathToFile);
-    } else {
-        full_encode(0, false, pathToFile);
+    std::string pathToFile = argv[arg];
+    try {
+        const int runtime = argc - arg == 2 ? atoi(argv[arg + 1]) * 1000 : 0;
+        if (options.reoptimise) {
+            full_reoptimise(runtime, pathToFile, engine, options);
+        } else {
+            full_encode(runtime, false, pathToFile, engine, options);
+        }
+    } catch (std::invalid_argument& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
     }
     return 0;
 }
 
-void full_encode(int runtime, bool exportChannels, const std::string path) {
+void full_encode(int runtime, bool exportChannels, const std::string path, const std::string& engine, const EncodeOptions& options) {
 
     long w = 0, wW = 0;
     int runs = 0;
@@ -48,14 +160,30 @@ void full_encode(int runtime, bool exportChannels, const std::string path) {
 
         PPMParser<BlockwiseRawImage> test(stepSize, stepSize);
         shared_ptr<BlockwiseRawImage> temp = test.parsePPM(path);
-        ImageProcessor<float, SeparatedCosinusTransform<float>> ip;
+        const auto encoder = EncoderRegistry::create(engine);
+        if (options.quality > 0) {
+            encoder->setQuality(options.quality);
+        }
+        encoder->setTrellis(options.trellis);
+        encoder->setRestartInterval(options.restartInterval);
+        encoder->setStandardTables(options.standardTables);
+        encoder->setCoefficientScan(options.coefficientScan);
+        encoder->setSampleRows(options.sampleRows);
+        encoder->setProfile(options.profile);
+        encoder->setArithmeticCoding(options.arithmeticCoding);
+        encoder->setScanScript(options.scanScript);
+        if (options.predictSize && runs == 0) {
+            const EncodedSizePrediction prediction = encoder->predictSize(*temp);
+            std::cout << "Predicted size: " << prediction.minimumBytes() << " to " << prediction.maximumBytes()
+                      << " bytes (" << prediction.headerBytes << " header bytes, " << prediction.scanBits
+                      << " scan bits, " << prediction.markerBytes << " bytes of restart markers)\n";
+        }
         std::string output = path.substr(0, path.size()-4);
-        BitStream bs(output + ".jpg", temp->width, temp->height);
-        ip.processImage(*temp, bs);
+        encoder->encode(*temp, output + ".jpg");
 
         auto endTime = std::chrono::high_resolution_clock::now();
         w += std::chrono::duration_cast<std::chrono::milliseconds>(endTime - startTime).count();
-        bs.writeOut();
+        encoder->writeOut();
 
         auto endTimeWithWrite = std::chrono::high_resolution_clock::now();
         wW += std::chrono::duration_cast<std::chrono::milliseconds>(endTimeWithWrite - startTime).count();
@@ -73,4 +201,33 @@ void full_encode(int runtime, bool exportChannels, const std::string path) {
     }
     std::cout << "Time to encode full image: " << static_cast<double>(w) / (runs) << " ms, time to encode and write: "
         << static_cast<double>(wW) / runs << " ms (with " << runs << " sample runs).\n";
-}
\ No newline at end of file
+}
+
+void full_reoptimise(int runtime, const std::string& path, const std::string& engine, const EncodeOptions& options) {
+    // written next to the input, which is never overwritten
+    const std::string output = path.substr(0, path.find_last_of('.')) + ".optimised.jpg";
+
+    long w = 0, wW = 0;
+    int runs = 0;
+    for (;;) {
+        auto startTime = std::chrono::high_resolution_clock::now();
+
+        const auto encoder = EncoderRegistry::create(engine);
+        encoder->setRestartInterval(options.restartInterval);
+        encoder->setScanScript(options.scanScript);
+        encoder->reoptimise(path, output);
+
+        auto endTime = std::chrono::high_resolution_clock::now();
+        w += std::chrono::duration_cast<std::chrono::milliseconds>(endTime - startTime).count();
+        encoder->writeOut();
+
+        auto endTimeWithWrite = std::chrono::high_resolution_clock::now();
+        wW += std::chrono::duration_cast<std::chrono::milliseconds>(endTimeWithWrite - startTime).count();
+
+        ++runs;
+        if(w > runtime)
+            break;
+    }
+    std::cout << "Time to re-optimise the image: " << static_cast<double>(w) / (runs) << " ms, time to re-optimise and write: "
+        << static_cast<double>(wW) / runs << " ms (with " << runs << " sample runs).\n";
+}
@@ -0,0 +1,85 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include "PPMParser.h"
+#include "EncodingProcessor.h"
+#include "HuffmanTableProfile.h"
+#include "dct/SeparatedCosinusTransform.h"
+#include "HuffmenTreeSorts/HuffmanTreePackageMerge.h"
+
+/*
+ * Trains a Huffman table profile on a corpus of PPM images. The symbols of every image are counted with the
+ * quantisation of the encoder, the per-image histograms are dumped to stdout (one line per table with symbol:count
+ * pairs), and the optimal tables for the summed histograms are written as a profile for ./MedienInfo --profile=file.
+ */
+
+static void dumpHistogram(const std::string& image, const char* table, const std::array<uint32_t, 256>& histogram) {
+    std::cout << image << " " << table;
+    for (unsigned int symbol = 0; symbol < histogram.size(); ++symbol) {
+        if (histogram[symbol] != 0) {
+            std::cout << " " << symbol << ":" << histogram[symbol];
+        }
+    }
+    std::cout << "\n";
+}
+
+int main(int argc, char* argv[]) {
+    int quality = 0;
+    int arg = 1;
+    for (; arg < argc && std::string(argv[arg]).rfind("--", 0) == 0; ++arg) {
+        const std::string option = argv[arg];
+        if (option.rfind("--quality=", 0) == 0) {
+            quality = atoi(option.substr(10).c_str());
+            if (quality < 1 || quality > 100) {
+                std::cerr << "The quality has to be between 1 and 100" << std::endl;
+                return 1;
+            }
+        } else {
+            std::cerr << "Unknown option " << option << std::endl;
+            return 1;
+        }
+    }
+
+    if (argc - arg < 3) {
+        std::cerr << "Usage: ./ProfileTrainer [--quality=1..100] name output.profile image.ppm [image.ppm ...]" << std::endl;
+        return 1;
+    }
+
+    const std::string name = argv[arg];
+    const std::string output = argv[arg + 1];
+
+    ImageProcessor<float, SeparatedCosinusTransform<float>> processor;
+    if (quality > 0) {
+        processor.setQuality(quality);
+    }
+
+    SymbolHistograms corpus;
+    for (int i = arg + 2; i < argc; ++i) {
+        std::shared_ptr<BlockwiseRawImage> image;
+        {
+            // the destructor waits for the reader thread
+            PPMParser<BlockwiseRawImage> parser(8, 8);
+            image = parser.parsePPM(argv[i]);
+        }
+
+        const SymbolHistograms histograms = processor.collectHistograms(*image, 1);
+        dumpHistogram(argv[i], "y_ac", histograms.y_ac);
+        dumpHistogram(argv[i], "y_dc", histograms.y_dc);
+        dumpHistogram(argv[i], "c_ac", histograms.c_ac);
+        dumpHistogram(argv[i], "c_dc", histograms.c_dc);
+        corpus += histograms;
+    }
+
+    // images outside of the corpus can contain symbols that never occurred in it
+    corpus.addSmoothingFloor();
+
+    using Tree = HuffmanTreePackageMerge<256, uint8_t, uint32_t, uint8_t, 16>;
+    try {
+        HuffmanTableProfile::train<Tree>(name, quality, corpus).save(output);
+    } catch (std::runtime_error& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    std::cerr << "Wrote the profile " << name << " trained on " << argc - arg - 2 << " images to " << output << std::endl;
+    return 0;
+}
@@ -0,0 +1,47 @@
+#ifndef MEDIENINFO_QUANTISER_H
+#define MEDIENINFO_QUANTISER_H
+
+#include <Vc/Vc>
+#include <array>
+#include <cmath>
+#include "quantisationTables.h"
+
+/**
+ * Quantises with precomputed reciprocals of a table, so every coefficient costs a multiplication and a rounding
+ * instead of a sign dependent rounding offset and a division.
+ */
+class Quantiser {
+private:
+    using uint = unsigned int;
+    using vec8 = Vc::fixed_size_simd<float, 8>;
+    using ivec8 = Vc::fixed_size_simd<int32_t, 8>;
+
+    // same order as the table
+    alignas(32) std::array<float, 64> reciprocals;
+
+public:
+    const QuantisationTable table;
+
+    explicit Quantiser(const QuantisationTable& table) : table(table) {
+        for (uint i = 0; i < 64; ++i) {
+            reciprocals[i] = 1.f / table[i];
+        }
+    }
+
+    /**
+     * Quantises the coefficient with the horizontal frequency u and the vertical frequency v.
+     */
+    template<typename Tout>
+    inline Tout quantise(const float value, const uint u, const uint v) const {
+        return static_cast<Tout>(std::nearbyint(value * reciprocals[(v << 3) + u]));
+    }
+
+    /**
+     * Quantises all horizontal frequencies for the vertical frequency v at once.
+     */
+    inline ivec8 quantiseRow(const vec8& row, const uint v) const {
+        return Vc::simd_cast<ivec8>(Vc::round(row * vec8(&reciprocals[v << 3], Vc::Aligned)));
+    }
+};
+
+#endif //MEDIENINFO_QUANTISER_H
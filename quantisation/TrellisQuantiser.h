@@ -0,0 +1,142 @@
+#ifndef MEDIENINFO_TRELLISQUANTISER_H
+#define MEDIENINFO_TRELLISQUANTISER_H
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include "quantisationTables.h"
+#include "../helper/MagnitudeCategory.h"
+#include "../helper/RunLength.h"
+
+/**
+ * Rate-distortion optimised quantisation of the AC coefficients of a block. For every coefficient the rounded value,
+ * the value one step closer to zero and zero are candidates, a dynamic program over the position of the previous non
+ * zero coefficient picks the combination with the lowest distortion + lambda * bits. The bits are estimated from the
+ * run/size statistics of a plain quantisation pass, so the result is still coded with ordinary baseline tables.
+ */
+class TrellisQuantiser {
+private:
+    using uint = unsigned int;
+
+    static constexpr uint blocksize = 64;
+
+    // estimated code length of every run/size symbol
+    std::array<float, 256> symbolBits;
+    // quantisation steps in zigzag order
+    std::array<float, blocksize> steps;
+    float lambda;
+
+public:
+    /**
+     * @param table quantisation table in natural order
+     * @param naturalOrder natural index of every zigzag position
+     * @param histogram run/size statistics of the AC coefficients
+     * @param lambdaScale lambda relative to the mean squared AC quantisation step
+     */
+    template<typename OrderTable, typename AmountType>
+    TrellisQuantiser(const QuantisationTable& table, const OrderTable& naturalOrder,
+                     const std::array<AmountType, 256>& histogram, const float lambdaScale = defaultLambdaScale) {
+        uint64_t total = 0;
+        for (const auto amount : histogram) {
+            total += amount;
+        }
+
+        // unused symbols would need a code in the final table, they get the longest possible code
+        for (uint s = 0; s < symbolBits.size(); ++s) {
+            symbolBits[s] = histogram[s] == 0 ? 16.f : std::min(16.f, std::log2(static_cast<float>(total) / histogram[s]));
+        }
+
+        float stepSum = 0;
+        for (uint i = 0; i < blocksize; ++i) {
+            steps[i] = static_cast<float>(table[naturalOrder[i]]);
+            stepSum += i == 0 ? 0 : steps[i] * steps[i];
+        }
+        lambda = lambdaScale * stepSum / (blocksize - 1);
+    }
+
+    static constexpr float defaultLambdaScale = 0.04f;
+
+    /**
+     * Quantises the AC coefficients (zigzag positions 1..63) of the raw coefficients, the DC value is left untouched.
+     */
+    template<typename Tout>
+    void quantiseBlock(const float* raw, Tout* out) const {
+        constexpr float infinity = std::numeric_limits<float>::infinity();
+
+        // distortion when the coefficients up to a position are zero
+        std::array<float, blocksize> zeroDistortion;
+        zeroDistortion[0] = 0;
+        for (uint k = 1; k < blocksize; ++k) {
+            zeroDistortion[k] = zeroDistortion[k - 1] + raw[k] * raw[k];
+        }
+
+        // cost[k]: lowest cost of the positions 1..k when k is the last non zero coefficient (0 is the block start)
+        std::array<float, blocksize> cost;
+        std::array<Tout, blocksize> value;
+        std::array<uint8_t, blocksize> previous;
+        cost[0] = 0;
+
+        for (uint k = 1; k < blocksize; ++k) {
+            cost[k] = infinity;
+
+            const int rounded = static_cast<int>(std::nearbyint(raw[k] / steps[k]));
+            if (rounded == 0) {
+                continue;
+            }
+
+            // the rounded value and the value one step closer to zero
+            const int candidates[2] = { rounded, rounded - (rounded > 0 ? 1 : -1) };
+            for (const int candidate : candidates) {
+                if (candidate == 0) {
+                    continue;
+                }
+
+                const float error = raw[k] - candidate * steps[k];
+                const uint size = magnitudeCategory(static_cast<int16_t>(candidate));
+                const float own = error * error + lambda * size;
+
+                for (int j = k - 1; j >= 0; --j) {
+                    if (cost[j] == infinity) {
+                        continue;
+                    }
+
+                    const uint run = k - j - 1;
+                    const float bits = (run >> 4) * symbolBits[zeroRunSymbol] + symbolBits[((run & 15) << 4) | size];
+                    const float total = cost[j] + (zeroDistortion[k - 1] - zeroDistortion[j]) + own + lambda * bits;
+                    if (total < cost[k]) {
+                        cost[k] = total;
+                        value[k] = static_cast<Tout>(candidate);
+                        previous[k] = static_cast<uint8_t>(j);
+                    }
+                }
+            }
+        }
+
+        // pick the last non zero coefficient, everything after it is covered by the EOB
+        uint last = 0;
+        float best = infinity;
+        for (uint k = 0; k < blocksize; ++k) {
+            if (cost[k] == infinity) {
+                continue;
+            }
+
+            const float total = cost[k] + (zeroDistortion[blocksize - 1] - zeroDistortion[k])
+                                + (k < blocksize - 1 ? lambda * symbolBits[endOfBlockSymbol] : 0);
+            if (total < best) {
+                best = total;
+                last = k;
+            }
+        }
+
+        for (uint k = 1; k < blocksize; ++k) {
+            out[k] = 0;
+        }
+        for (uint k = last; k != 0; k = previous[k]) {
+            out[k] = value[k];
+        }
+    }
+};
+
+#endif //MEDIENINFO_TRELLISQUANTISER_H
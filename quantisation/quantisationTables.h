@@ -3,8 +3,48 @@
 
 #include <array>
 
+// all tables are in natural order, row-major with the vertical frequency as row (like the examples in ISO/IEC 10918-1)
 using QuantisationTable = std::array<int, 64>;
 
+// ISO/IEC 10918-1 Annex K.1, these are the base tables for quality scaling
+constexpr QuantisationTable annexKLuminance = {
+        16, 11, 10, 16,  24,  40,  51,  61,
+        12, 12, 14, 19,  26,  58,  60,  55,
+        14, 13, 16, 24,  40,  57,  69,  56,
+        14, 17, 22, 29,  51,  87,  80,  62,
+        18, 22, 37, 56,  68, 109, 103,  77,
+        24, 35, 55, 64,  81, 104, 113,  92,
+        49, 64, 78, 87, 103, 121, 120, 101,
+        72, 92, 95, 98, 112, 100, 103,  99
+};
+
+constexpr QuantisationTable annexKChrominance = {
+        17, 18, 24, 47, 99, 99, 99, 99,
+        18, 21, 26, 66, 99, 99, 99, 99,
+        24, 26, 56, 99, 99, 99, 99, 99,
+        47, 66, 99, 99, 99, 99, 99, 99,
+        99, 99, 99, 99, 99, 99, 99, 99,
+        99, 99, 99, 99, 99, 99, 99, 99,
+        99, 99, 99, 99, 99, 99, 99, 99,
+        99, 99, 99, 99, 99, 99, 99, 99
+};
+
+/**
+ * Scales a base table with the IJG quality factor (1..100, 50 returns the base table). The values are clamped to
+ * 1..255 since the DQT segment is written with 8 bit precision.
+ */
+constexpr QuantisationTable scaleQuantisationTable(const QuantisationTable& base, int quality) {
+    quality = quality < 1 ? 1 : (quality > 100 ? 100 : quality);
+    const int scale = quality < 50 ? 5000 / quality : 200 - quality * 2;
+
+    QuantisationTable result {};
+    for (unsigned int i = 0; i < result.size(); ++i) {
+        const int value = (base[i] * scale + 50) / 100;
+        result[i] = value < 1 ? 1 : (value > 255 ? 255 : value);
+    }
+    return result;
+}
+
 const static QuantisationTable luminaceOnePlus5 = {
         2,  1,  1,  2,  2,  4,  5,  6,
         1,  1,  1,  2,  3,  6,  6,  6,
@@ -0,0 +1,29 @@
+#ifndef MEDIENINFO_DAC_H
+#define MEDIENINFO_DAC_H
+
+#include <cstdint>
+#include "../helper/EndianConvert.h"
+
+// arithmetic coding conditioning of the tables SOS selects, DC 0 and 1 and AC 2 and 3 (ITU T.81 B.2.4.3)
+struct DAC {
+    const uint16_t marker = convert_u16(0xFFCC);
+    const uint16_t len = convert_u16(10); // segment length without marker = 2 + table_amount * 2
+
+    struct Conditioning {
+        uint8_t tableClassAndNumber; // high nibble 0 = DC, 1 = AC, low nibble the table number
+        uint8_t value; // DC: U << 4 | L, AC: Kx
+    } __attribute__((packed));
+
+    Conditioning conditionings[4];
+
+    DAC(const uint8_t dcLower, const uint8_t dcUpper, const uint8_t acThreshold) :
+        conditionings {
+            { 0x00, static_cast<uint8_t>((dcUpper << 4) | dcLower) },
+            { 0x01, static_cast<uint8_t>((dcUpper << 4) | dcLower) },
+            { 0x12, acThreshold },
+            { 0x13, acThreshold }
+        } {}
+
+} __attribute__((packed));
+
+#endif //MEDIENINFO_DAC_H
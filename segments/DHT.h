@@ -16,8 +16,9 @@ struct DHT {
 
     explicit DHT(uint16_t len) : len(convert_u16(len)) {}
 
-    template<uint8_t max_tree_depth, typename InputKeyType, typename CountType>
-    static inline void write(BitStream& stream, uint8_t ht_info, const std::array<CountType, max_tree_depth+1>& bits, const std::vector<InputKeyType>& huffval) {
+    // huffval is a std::vector or std::array of the symbols
+    template<uint8_t max_tree_depth, typename CountType, typename Values, typename Stream>
+    static inline void write(Stream& stream, uint8_t ht_info, const std::array<CountType, max_tree_depth+1>& bits, const Values& huffval) {
         uint32_t amountOfLeaves = 0;
         for (auto x : bits) amountOfLeaves += x;
 
@@ -28,14 +29,14 @@ struct DHT {
         stream.writeByteAligned(ht_info);
         stream.writeBytes(&bits[1], (sizeof(bits) - 1) * sizeof(CountType));
         //stream.writeBytes(&huffval[0], huffval.size() * sizeof(InputKeyType));
-        stream.writeBytes(&huffval[0], amountOfLeaves * sizeof(InputKeyType));
+        stream.writeBytes(&huffval[0], amountOfLeaves * sizeof(huffval[0]));
     }
 
-    template<uint8_t max_tree_depth, typename InputKeyType, typename CountType>
-    static inline void write(BitStream& stream, uint8_t tree_num, uint8_t is_ac, const std::array<CountType, max_tree_depth+1>& bits, const std::vector<InputKeyType>& huffval) {
+    template<uint8_t max_tree_depth, typename CountType, typename Values, typename Stream>
+    static inline void write(Stream& stream, uint8_t tree_num, uint8_t is_ac, const std::array<CountType, max_tree_depth+1>& bits, const Values& huffval) {
         assert(tree_num < 4);
         assert(is_ac < 2);
-        write<max_tree_depth, InputKeyType, CountType>(stream, (tree_num) | (is_ac << 4), bits, huffval);
+        write<max_tree_depth, CountType>(stream, (tree_num) | (is_ac << 4), bits, huffval);
     }
 
 } __attribute__((packed));
@@ -0,0 +1,18 @@
+#ifndef MEDIENINFO_DRI_H
+#define MEDIENINFO_DRI_H
+
+#include <cstdint>
+#include "../helper/EndianConvert.h"
+
+struct DRI {
+    const uint16_t marker = convert_u16(0xFFDD);
+    const uint16_t len = convert_u16(4); // length of the segment without the marker
+    uint16_t restartInterval; // amount of MCUs between two RSTn markers
+
+    explicit DRI(const uint16_t interval) {
+        restartInterval = convert_u16(interval);
+    }
+
+} __attribute__((packed));
+
+#endif //MEDIENINFO_DRI_H
@@ -4,9 +4,13 @@
 #include <cstdint>
 #include "../helper/EndianConvert.h"
 
-// this struct is fixed for 3 channels
+// this struct is fixed for 3 channels, the other processes only differ in the marker
 struct SOF0 {
-    const uint16_t marker = convert_u16(0xFFC0);
+    static constexpr uint16_t baseline = 0xFFC0;
+    static constexpr uint16_t progressive = 0xFFC2; // SOF2, progressive with Huffman coding
+    static constexpr uint16_t arithmetic = 0xFFC9; // SOF9, extended sequential with arithmetic coding
+
+    uint16_t marker;
     const uint16_t len = convert_u16(17); // segment length without marker = 8 + component_amount * 3
     const uint8_t BitsPerSample = 8; // prescicion of the data
     uint16_t imageHeight;   // image height
@@ -25,7 +29,8 @@ struct SOF0 {
     const uint8_t CRcompOversampling = 0x11;  // 0x22 = no subsampling, 0x11 = with subsampling
     const uint8_t CRcompTableNumber = 1; //used subsampling table
 
-    SOF0(const int height, const int width) {
+    SOF0(const int height, const int width, const uint16_t frameMarker = baseline) {
+        marker = convert_u16(frameMarker);
         imageHeight = convert_u16(static_cast<uint16_t>(height));
         imageWidth = convert_u16(static_cast<uint16_t>(width));
     }
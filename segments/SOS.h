@@ -2,6 +2,7 @@
 #define MEDIENINFO_SOS_H
 
 #include <cstdint>
+#include <vector>
 #include "../helper/EndianConvert.h"
 
 struct SOS {
@@ -18,6 +19,28 @@ struct SOS {
     uint8_t unused2 = 0x3f; // end of spectral selection
     uint8_t unused3 = 0x00; // successive approximation
 
+    /**
+     * A scan of a progressive image with the given components (1 = Y, 2 = Cb, 3 = Cr), their table selectors
+     * (DC table << 4 | AC table), the band Ss..Se and the successive approximation Ah, Al.
+     */
+    template<typename Stream>
+    static void write(Stream& stream, const std::vector<uint8_t>& components, const std::vector<uint8_t>& tables,
+                      const uint8_t Ss, const uint8_t Se, const uint8_t Ah, const uint8_t Al) {
+        const uint16_t length = static_cast<uint16_t>(6 + 2 * components.size());
+        stream.writeByteAligned(0xFF);
+        stream.writeByteAligned(0xDA);
+        stream.writeByteAligned(static_cast<uint8_t>(length >> 8));
+        stream.writeByteAligned(static_cast<uint8_t>(length));
+        stream.writeByteAligned(static_cast<uint8_t>(components.size()));
+        for (size_t i = 0; i < components.size(); ++i) {
+            stream.writeByteAligned(components[i]);
+            stream.writeByteAligned(tables[i]);
+        }
+        stream.writeByteAligned(Ss);
+        stream.writeByteAligned(Se);
+        stream.writeByteAligned(static_cast<uint8_t>((Ah << 4) | Al));
+    }
+
 } __attribute__((packed));
 
 #endif //MEDIENINFO_SOS_H